@@ -1,5 +1,6 @@
 #include <iostream>
 #include <queue>
+#include <deque>
 #include <string>
 #include <vector>
 #include <thread>
@@ -10,204 +11,5279 @@
 #include <algorithm>
 #include <map>
 #include <set>
+#include <atomic>
+#include <random>
+#include <fstream>
+#include <memory>
+#include <cstring>
+#include <functional>
+#include <filesystem>
+#include <cstdio>
+#include <cstdint>
+#include <ctime>
+#include <iomanip>
+#include <tuple>
+#include <charconv>
+#include <type_traits>
+#ifndef _WIN32
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#endif
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define KITCHEN_AVX2 1
+#define AVX2_TARGET __attribute__((target("avx2")))
+#endif
 
 using namespace std;
 
+// Menu items, used as indices into the compile-time menu table
+enum MenuItem : unsigned char { ITEM_PIZZA, ITEM_BURGER, ITEM_PASTA, ITEM_SALAD, ITEM_COUNT };
+
+// Structure to represent one entry of the menu
+struct MenuEntry {
+    const char* name;          // Name shown to guests
+    int priceCents;            // Price in cents
+};
+
+// The built-in menu, indexed by MenuItem (the config file renames and reprices items in baseMenu)
+constexpr MenuEntry menu[ITEM_COUNT] = {
+    { "Pizza", 1200 },
+    { "Burger", 1000 },
+    { "Pasta", 1100 },
+    { "Salad", 800 },
+};
+
+// Structure to represent one published version of the menu. A version never changes once it is
+// published: an update publishes a new one, and each order keeps the version it was placed under,
+// so a later change never reprices or 86es an order already taken.
+struct MenuVersion {
+    int version = 0;                    // Increases by one with every published change
+    string names[ITEM_COUNT];           // Name shown to guests
+    int priceCents[ITEM_COUNT] = {};    // Price in cents
+    int prepTimePct[ITEM_COUNT] = {};   // Scale of the item's step durations, in percent
+    bool available[ITEM_COUNT] = {};    // False once the item is 86'd
+    bool special[ITEM_COUNT] = {};      // Shown to guests as a special
+};
+
+// Function to build a menu version from the built-in menu
+MenuVersion builtInMenu() {
+    MenuVersion version;
+    for (int i = 0; i < ITEM_COUNT; ++i) {
+        version.names[i] = menu[i].name;
+        version.priceCents[i] = menu[i].priceCents;
+        version.prepTimePct[i] = 100;
+        version.available[i] = true;
+    }
+    return version;
+}
+
+MenuVersion baseMenu = builtInMenu();   // Base menu: the built-in one as changed by the config file
+
+// The current menu (see updateMenu). C++20 has atomic<shared_ptr>; before it, the free atomic_*
+// functions on shared_ptr stand in (they are deprecated from C++20). Neither is lock-free in
+// libstdc++: each load or exchange takes a short internal lock (a spinlock bit, or a mutex from a
+// pool picked by address), held only while the pointer and its reference count are copied.
+#if defined(__cpp_lib_atomic_shared_ptr)
+atomic<shared_ptr<const MenuVersion>> publishedMenu{ make_shared<MenuVersion>() };
+#else
+shared_ptr<const MenuVersion> publishedMenu = make_shared<MenuVersion>();
+#endif
+
+// Function to get the current menu version; the version stays valid while held
+shared_ptr<const MenuVersion> currentMenu() {
+#if defined(__cpp_lib_atomic_shared_ptr)
+    return publishedMenu.load();
+#else
+    return atomic_load(&publishedMenu);
+#endif
+}
+
+// Function to publish a changed menu. Readers only wait for a pointer copy, never for a version
+// being built, and keep whichever version they loaded; concurrent updates retry on a
+// compare-exchange, so none is lost. Returns the new version.
+int updateMenu(const function<void(MenuVersion&)>& change) {
+    shared_ptr<const MenuVersion> current = currentMenu();
+    while (true) {
+        auto next = make_shared<MenuVersion>(*current);
+        next->version = current->version + 1;
+        change(*next);
+#if defined(__cpp_lib_atomic_shared_ptr)
+        if (publishedMenu.compare_exchange_strong(current, shared_ptr<const MenuVersion>(next)))
+#else
+        if (atomic_compare_exchange_strong(&publishedMenu, &current, shared_ptr<const MenuVersion>(next)))
+#endif
+            return next->version;
+    }
+}
+
+using OrderId = long long;     // 64-bit order ID, unique across restarts and shards (see nextOrderId)
+
+// Priority classes: a higher class is always dispatched first, and can preempt a lower one at an item boundary
+enum OrderPriority : unsigned char { PRIORITY_NORMAL, PRIORITY_RUSH, PRIORITY_VIP, PRIORITY_REFIRE, PRIORITY_COUNT };
+
+// List of priority class names (index = OrderPriority)
+constexpr const char* priorityNames[PRIORITY_COUNT] = { "normal", "rush", "VIP", "re-fire" };
+
+// Lifecycle of an order, kept in the atomic state word of its handle. Cancelling an order is one
+// CAS on that word, so it costs the same however long the queue is and never takes queueMutex;
+// workers skip cancelled orders when they dequeue them. Changing an order is the same CAS plus a
+// constant-time fix of its lane's item count under queueMutex (see modifyOrder).
+enum OrderState : int { ORDER_QUEUED, ORDER_MODIFYING, ORDER_IN_PROGRESS, ORDER_CANCELLED, ORDER_COMPLETED };
+
+// Structure to represent the handle a guest keeps on a submitted order
+struct OrderHandle {
+    OrderId orderID = 0;                   // Order the handle refers to
+    atomic<int> state{ ORDER_QUEUED };     // Current OrderState
+    bool holdsIngredients = false;         // Whether the order's ingredients were reserved
+    vector<MenuItem> foods;                // Current items (written only while ORDER_MODIFYING, under queueMutex)
+    bool revised = false;                  // Whether foods differ from the items queued with the order
+    int queuedLane = -1;                   // Lane the order was last queued in (guarded by queueMutex)
+};
+
 // Structure to represent an order
 struct Order {
-    int orderID;               // Unique ID for the order
-    vector<string> foods;      // List of food items in the order
+    OrderId orderID;           // Unique ID for the order
+    vector<MenuItem> foods;    // List of food items in the order
     int table;                 // Table number assigned to the order
     bool isCompleted;          // Whether the order is completed
     int workerID;              // ID of the worker processing the order
+    chrono::steady_clock::time_point arrivalTime; // When the order was placed
+    chrono::steady_clock::time_point deadline;    // When the order was promised by
+    chrono::steady_clock::time_point completedTime; // When the order was finished
+    OrderPriority priority = PRIORITY_NORMAL;          // Priority class the order was placed with
+    OrderPriority inheritedPriority = PRIORITY_NORMAL; // Class inherited while a higher one waits for its table
+    size_t itemsDone = 0;                              // Items finished before the order was preempted
+    shared_ptr<OrderHandle> handle;                    // Cancel/modify handle (null if untracked)
+    shared_ptr<const MenuVersion> menuVersion;         // Menu the order was placed under (null = base menu)
+    bool holdsIngredients = false;                     // Whether the order's ingredients were reserved
+};
+
+// Function to get the price an order was sold at for one of its items
+inline int soldPriceCents(const Order& order, MenuItem food) {
+    return order.menuVersion ? order.menuVersion->priceCents[food] : baseMenu.priceCents[food];
+}
+
+// Function to get the name of one of an order's items as it was on the order's menu
+inline const char* soldItemName(const Order& order, MenuItem food) {
+    return order.menuVersion ? order.menuVersion->names[food].c_str() : baseMenu.names[food].c_str();
+}
+
+// Function to get the number of the menu version an order was placed under (-1 = base menu)
+inline int menuVersionNumber(const Order& order) {
+    return order.menuVersion ? order.menuVersion->version : -1;
+}
+
+// Structure to collect the names items were sold under, so reports label items as guests saw
+// them. An item renamed during the day is labelled with all its names, e.g. "Pizza/Truffle Pizza".
+struct SoldItemNames {
+    vector<string> names[ITEM_COUNT];      // Distinct names per item, in order of first sale
+    int lastVersion[ITEM_COUNT];           // Menu version whose name was last added (-2 = none)
+
+    SoldItemNames() { fill(begin(lastVersion), end(lastVersion), -2); }
+
+    // Function to note the names of an order's items; names are only compared when the version changes
+    void add(const Order& order) {
+        int version = menuVersionNumber(order);
+        for (MenuItem food : order.foods) {
+            if (lastVersion[food] == version)
+                continue;
+            lastVersion[food] = version;
+            string name = soldItemName(order, food);
+            if (find(names[food].begin(), names[food].end(), name) == names[food].end())
+                names[food].push_back(name);
+        }
+    }
+
+    // Function to get the label of every item: its sold names, or its base name if it was not sold
+    vector<string> labels() const {
+        vector<string> result(ITEM_COUNT);
+        for (int i = 0; i < ITEM_COUNT; ++i) {
+            for (const auto& name : names[i])
+                result[i] += (result[i].empty() ? "" : "/") + name;
+            if (result[i].empty())
+                result[i] = baseMenu.names[i];
+        }
+        return result;
+    }
+};
+
+// Function to get what an order was sold for, at its own menu version's prices
+inline long long orderRevenueCents(const Order& order) {
+    long long revenue = 0;
+    for (MenuItem food : order.foods)
+        revenue += soldPriceCents(order, food);
+    return revenue;
+}
+
+// Function to get the class an order is currently dispatched in
+inline OrderPriority effectivePriority(const Order& order) {
+    return max(order.priority, order.inheritedPriority);
+}
+
+// Function to get the items an order counts for while queued: its handle's current items, which
+// a modify may have changed since the order was queued (queueMutex held)
+inline int queuedItems(const Order& order) {
+    return (int)(order.handle ? order.handle->foods.size() : order.foods.size());
+}
+
+// Function to check whether an order has been cancelled (a single atomic load)
+inline bool orderCancelled(const Order& order) {
+    return order.handle && order.handle->state.load(memory_order_acquire) == ORDER_CANCELLED;
+}
+
+// Function for a worker to take an order it dequeued: queued -> in progress, applying any change
+// made while it waited. Returns false if the order was cancelled.
+bool claimOrder(Order& order) {
+    if (!order.handle)
+        return true;
+    OrderHandle& handle = *order.handle;
+    int state = handle.state.load(memory_order_acquire);
+    while (true) {
+        if (state == ORDER_CANCELLED)
+            return false;
+        if (state == ORDER_MODIFYING) {
+            this_thread::yield(); // A change is being written: it takes only a few stores
+            state = handle.state.load(memory_order_acquire);
+            continue;
+        }
+        if (state == ORDER_IN_PROGRESS)
+            return true; // Resumed after preemption or a round-robin slice
+        if (handle.state.compare_exchange_weak(state, ORDER_IN_PROGRESS, memory_order_acq_rel))
+            break;
+    }
+    if (handle.revised)
+        order.foods = handle.foods;
+    return true;
+}
+
+// Function to mark an in-progress order completed; returns false if it was cancelled first
+bool completeOrderState(const Order& order) {
+    if (!order.handle)
+        return true;
+    int expected = ORDER_IN_PROGRESS;
+    return order.handle->state.compare_exchange_strong(expected, ORDER_COMPLETED, memory_order_acq_rel);
+}
+
+// Min-heap with D children per node: shallower than a binary heap, so pops touch fewer cache lines
+template <typename T, typename Less, int D = 4>
+class DaryHeap {
+public:
+    bool empty() const { return items.empty(); }
+    size_t size() const { return items.size(); }
+    const T& top() const { return items.front(); }
+    const vector<T>& contents() const { return items; }
+    void reserve(size_t capacity) { items.reserve(capacity); }
+
+    void push(const T& item) {
+        items.push_back(item);
+        size_t i = items.size() - 1;
+        while (i > 0) {
+            size_t parent = (i - 1) / D;
+            if (!less(items[i], items[parent]))
+                break;
+            swap(items[i], items[parent]);
+            i = parent;
+        }
+    }
+
+    void pop() {
+        items.front() = move(items.back());
+        items.pop_back();
+        siftDown(0);
+    }
+
+    // Function to hand every item matching 'pred' to 'take' and drop it, then re-heapify the
+    // rest in place (the storage and its reserved capacity are kept)
+    template <typename Pred, typename Take>
+    void removeIf(Pred pred, Take take) {
+        auto removed = partition(items.begin(), items.end(), [&](const T& item) { return !pred(item); });
+        if (removed == items.end())
+            return;
+        for (auto it = removed; it != items.end(); ++it)
+            take(*it);
+        items.erase(removed, items.end());
+        for (size_t i = items.size() / D + 1; i-- > 0;)
+            siftDown(i);
+    }
+
+private:
+    // Function to move the item at 'i' down until neither of its children is smaller
+    void siftDown(size_t i) {
+        while (true) {
+            size_t best = i;
+            size_t first = i * D + 1;
+            for (size_t c = first; c < first + D && c < items.size(); ++c)
+                if (less(items[c], items[best]))
+                    best = c;
+            if (best == i)
+                break;
+            swap(items[i], items[best]);
+            i = best;
+        }
+    }
+
+    vector<T> items;
+    Less less;
+};
+
+// Dispatch policies for the worker queue
+enum DispatchPolicy { DISPATCH_FCFS, DISPATCH_EDF };
+DispatchPolicy dispatchPolicy = DISPATCH_FCFS; // Policy used for orders pushed from now on
+
+// Ordering for EDF dispatch: earliest deadline first, then lowest order ID
+struct EarlierDeadline {
+    bool operator()(const Order& a, const Order& b) const {
+        if (a.deadline != b.deadline)
+            return a.deadline < b.deadline;
+        return a.orderID < b.orderID;
+    }
+};
+
+// Orders of one priority class, dispatched first-come first-served or earliest deadline first
+struct OrderLane {
+    deque<Order> fifo;                           // Orders pushed under FCFS
+    DaryHeap<Order, EarlierDeadline> edf;        // Orders pushed under EDF
+    int items = 0;                               // Items of all orders in the lane
+
+    bool empty() const { return fifo.empty() && edf.empty(); }
+    size_t size() const { return fifo.size() + edf.size(); }
+    const Order& front() const { return edf.empty() ? fifo.front() : edf.top(); }
+
+    void push(const Order& order) {
+        items += queuedItems(order);
+        if (dispatchPolicy == DISPATCH_EDF)
+            edf.push(order);
+        else
+            fifo.push_back(order);
+    }
+
+    void pop() {
+        items -= queuedItems(front());
+        if (edf.empty())
+            fifo.pop_front();
+        else
+            edf.pop();
+    }
+
+    // Function to move the orders that hold a table into 'target', raised to 'priority'. Each
+    // order stays in the same kind of queue it was in (FIFO or EDF) whatever the current
+    // dispatch policy; returns the number of orders moved.
+    int raiseTableHoldersInto(OrderLane& target, OrderPriority priority) {
+        int raised = 0;
+        auto take = [&](Order& order) {
+            int size = queuedItems(order);
+            order.inheritedPriority = priority;
+            if (order.handle)
+                order.handle->queuedLane = priority;
+            items -= size;
+            target.items += size;
+            raised++;
+        };
+        auto holders = stable_partition(fifo.begin(), fifo.end(), [](const Order& order) { return order.table == 0; });
+        for (auto it = holders; it != fifo.end(); ++it) {
+            take(*it);
+            target.fifo.push_back(move(*it));
+        }
+        fifo.erase(holders, fifo.end());
+        edf.removeIf([](const Order& order) { return order.table != 0; }, [&](Order& order) {
+            take(order);
+            target.edf.push(order);
+        });
+        return raised;
+    }
+};
+
+// Queue of orders waiting for a worker: one lane per priority class, highest class first.
+// Every change is made under queueMutex; the lanes' item counts and the head's arrival time are
+// also copied into atomics, so admission control can read them without the lock.
+struct OrderQueue {
+    OrderLane lanes[PRIORITY_COUNT];             // Lane of each priority class
+    atomic<int> publishedItems[PRIORITY_COUNT] = {}; // Copy of each lane's item count
+    atomic<long long> headArrival{ 0 };          // Arrival of the order at the head, in steady-clock ticks (0 = empty)
+
+    // Function to get the highest non-empty lane, or -1 if the queue is empty
+    int topLane() const {
+        for (int p = PRIORITY_COUNT - 1; p >= 0; --p)
+            if (!lanes[p].empty())
+                return p;
+        return -1;
+    }
+
+    bool empty() const { return topLane() < 0; }
+    size_t size() const {
+        size_t total = 0;
+        for (const auto& lane : lanes)
+            total += lane.size();
+        return total;
+    }
+    const Order& front() const { return lanes[topLane()].front(); }
+    void push(const Order& order) {
+        if (order.handle)
+            order.handle->queuedLane = effectivePriority(order);
+        lanes[effectivePriority(order)].push(order);
+        publishCounts();
+    }
+    void pop() {
+        lanes[topLane()].pop();
+        publishCounts();
+    }
+    void clear() {
+        for (auto& lane : lanes)
+            lane = OrderLane();
+        publishCounts();
+    }
+
+    // Function to change a lane's item count when a queued order's items change
+    void adjustItems(int lane, int delta) {
+        lanes[lane].items += delta;
+        publishCounts();
+    }
+
+    // Function to copy the item counts and the head's arrival time into the atomics
+    void publishCounts() {
+        for (int p = 0; p < PRIORITY_COUNT; ++p)
+            publishedItems[p].store(lanes[p].items, memory_order_relaxed);
+        int top = topLane();
+        headArrival.store(top < 0 ? 0 : lanes[top].front().arrivalTime.time_since_epoch().count(), memory_order_relaxed);
+    }
+
+    // Number of queued items from the given class up, read without queueMutex
+    int publishedItemsFrom(int priority) const {
+        int items = 0;
+        for (int p = priority; p < PRIORITY_COUNT; ++p)
+            items += publishedItems[p].load(memory_order_relaxed);
+        return items;
+    }
+
+    // Age of the order at the head of the queue at 'now' (zero if empty), read without queueMutex
+    chrono::steady_clock::duration headAge(chrono::steady_clock::time_point now) const {
+        long long arrival = headArrival.load(memory_order_relaxed);
+        if (arrival == 0)
+            return chrono::steady_clock::duration::zero();
+        return max(chrono::steady_clock::duration::zero(), now - chrono::steady_clock::time_point(chrono::steady_clock::duration(arrival)));
+    }
+
+    // Number of queued items in all lanes, from the given class up
+    int itemsFrom(int priority) const {
+        int items = 0;
+        for (int p = priority; p < PRIORITY_COUNT; ++p)
+            items += lanes[p].items;
+        return items;
+    }
+
+    // Number of queued items that would be dispatched before the given order (only EDF has to
+    // look at the orders themselves; under FCFS everything already queued goes first)
+    int itemsAhead(const Order& order) const {
+        if (dispatchPolicy != DISPATCH_EDF)
+            return itemsFrom(effectivePriority(order));
+        int items = 0;
+        for (int p = effectivePriority(order); p < PRIORITY_COUNT; ++p) {
+            int later = 0; // Items of EDF orders due after this one
+            for (const auto& queued : lanes[p].edf.contents())
+                if (EarlierDeadline()(order, queued))
+                    later += queuedItems(queued);
+            items += lanes[p].items - later; // FIFO orders pushed before the switch to EDF all go first
+        }
+        return items;
+    }
+
+    // Function to move queued orders that hold a table and sit below 'priority' up to that class
+    // (priority inheritance); returns the number of orders raised
+    int raiseTableHolders(OrderPriority priority) {
+        int raised = 0;
+        for (int p = PRIORITY_NORMAL; p < priority; ++p)
+            raised += lanes[p].raiseTableHoldersInto(lanes[priority], priority);
+        publishCounts();
+        return raised;
+    }
+};
+
+// Structure to represent worker credentials
+struct WorkerCredential {
+    int workerId;              // Unique ID for the worker
+    string fullName;           // Full name of the worker
+    string password;           // Password for the worker
+    int defaultTask;           // Default task assigned to the worker
+};
+
+// Worker tasks, numbered as shown in the registration menu
+enum Task { TASK_COOK = 1, TASK_SERVE, TASK_CLEAN_TABLE, TASK_WASH_DISHES, TASK_SELECT_TABLE, TASK_LIMIT };
+
+// List of task names corresponding to worker tasks (index = task number - 1)
+constexpr const char* taskNames[TASK_LIMIT - 1] = { "Cook", "Serve", "Clean Table", "Wash Dishes", "Select Table" };
+
+// Tracing: spans are appended to a fixed-size buffer owned by the recording thread, so recording
+// takes no lock. Buffers are registered once per thread and exported as Chrome trace JSON,
+// which opens directly in Perfetto or chrome://tracing.
+const size_t TRACE_BUFFER_CAPACITY = 1 << 16;
+atomic<bool> tracingEnabled(false);                 // Whether spans are recorded
+const chrono::steady_clock::time_point traceEpoch = chrono::steady_clock::now(); // Time zero of the trace
+
+// Structure to represent one completed span
+struct TraceEvent {
+    const char* name;          // Span name (static string)
+    const char* category;      // Span category (static string)
+    long long startUs;         // Start time in microseconds since traceEpoch
+    long long durationUs;      // Duration in microseconds
+    OrderId orderID;           // Order the span belongs to (0 if none)
+    int table;                 // Table involved (0 if none)
+    char detail[32];           // Free-form detail, e.g. the food item
+};
+
+// Structure to represent the trace buffer of one thread
+struct TraceBuffer {
+    int tid;                            // Trace thread ID
+    string threadName;                  // Name shown for the thread in the viewer
+    vector<TraceEvent> events;          // Preallocated event storage
+    atomic<size_t> count{ 0 };          // Events written so far (published with release)
+    atomic<long long> dropped{ 0 };     // Events lost because the buffer was full
+};
+
+vector<unique_ptr<TraceBuffer>> traceBuffers; // All registered per-thread buffers
+mutex traceRegistryMutex;                     // Leaf lock for buffer registration only (not instrumented,
+                                              // because instrumented locks record into the trace)
+thread_local TraceBuffer* localTraceBuffer = nullptr; // This thread's buffer
+
+// Function to get the current time in microseconds since traceEpoch
+long long traceNowUs() {
+    return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - traceEpoch).count();
+}
+
+// Function to get this thread's trace buffer, registering it on first use
+TraceBuffer* threadTraceBuffer() {
+    if (localTraceBuffer == nullptr) {
+        auto buffer = make_unique<TraceBuffer>();
+        buffer->events.resize(TRACE_BUFFER_CAPACITY);
+        lock_guard<mutex> lock(traceRegistryMutex);
+        buffer->tid = (int)traceBuffers.size() + 1;
+        buffer->threadName = "Thread " + to_string(buffer->tid);
+        localTraceBuffer = buffer.get();
+        traceBuffers.push_back(move(buffer));
+    }
+    return localTraceBuffer;
+}
+
+// Function to name the calling thread in the trace
+void setTraceThreadName(const string& name) {
+    if (tracingEnabled.load(memory_order_relaxed))
+        threadTraceBuffer()->threadName = name;
+}
+
+// Function to append a finished span to the calling thread's buffer
+void recordTraceEvent(const TraceEvent& event) {
+    TraceBuffer* buffer = threadTraceBuffer();
+    size_t index = buffer->count.load(memory_order_relaxed);
+    if (index >= TRACE_BUFFER_CAPACITY) {
+        buffer->dropped.fetch_add(1, memory_order_relaxed);
+        return;
+    }
+    buffer->events[index] = event;
+    buffer->count.store(index + 1, memory_order_release);
+}
+
+// RAII span: records from construction until end() or destruction. When tracing is
+// disabled, construction costs one relaxed load and branch, and nothing is recorded.
+struct TraceSpan {
+    TraceEvent event;
+
+    TraceSpan(const char* name, const char* category, OrderId orderID = 0, int table = 0, const char* detail = "") {
+        if (!tracingEnabled.load(memory_order_relaxed)) {
+            event.startUs = -1;
+            return;
+        }
+        event.name = name;
+        event.category = category;
+        event.orderID = orderID;
+        event.table = table;
+        strncpy(event.detail, detail, sizeof(event.detail) - 1);
+        event.detail[sizeof(event.detail) - 1] = '\0';
+        event.startUs = traceNowUs();
+    }
+
+    ~TraceSpan() {
+        end();
+    }
+
+    void end() {
+        if (event.startUs < 0)
+            return;
+        event.durationUs = traceNowUs() - event.startUs;
+        recordTraceEvent(event);
+        event.startUs = -1;
+    }
+};
+
+// Function to write a string as a JSON string literal
+void writeJsonString(ostream& out, const string& text) {
+    out << '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\')
+            out << '\\' << c;
+        else if ((unsigned char)c < 0x20)
+            out << ' ';
+        else
+            out << c;
+    }
+    out << '"';
+}
+
+// Function to export all recorded spans as Chrome trace JSON; call after the threads are joined
+bool writeChromeTrace(const string& path) {
+    ofstream out(path);
+    if (!out)
+        return false;
+    lock_guard<mutex> lock(traceRegistryMutex);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    long long dropped = 0;
+    for (const auto& buffer : traceBuffers) {
+        out << (first ? "" : ",\n") << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":"
+            << buffer->tid << ",\"args\":{\"name\":";
+        writeJsonString(out, buffer->threadName);
+        out << "}}";
+        first = false;
+        size_t count = buffer->count.load(memory_order_acquire);
+        for (size_t i = 0; i < count; ++i) {
+            const TraceEvent& e = buffer->events[i];
+            out << ",\n{\"ph\":\"X\",\"name\":";
+            writeJsonString(out, e.detail[0] ? string(e.name) + " " + e.detail : string(e.name));
+            out << ",\"cat\":\"" << e.category << "\",\"pid\":1,\"tid\":" << buffer->tid
+                << ",\"ts\":" << e.startUs << ",\"dur\":" << e.durationUs
+                << ",\"args\":{\"order\":" << e.orderID << ",\"table\":" << e.table << "}}";
+        }
+        dropped += buffer->dropped;
+    }
+    out << "\n]}\n";
+    cout << "Trace written to " << path;
+    if (dropped > 0)
+        cout << " (" << dropped << " events dropped: buffers full)";
+    cout << "\n";
+    return true;
+}
+
+// Function to format an amount in cents as dollars
+string formatCents(long long cents) {
+    char text[32];
+    snprintf(text, sizeof(text), "$%lld.%02lld", cents / 100, cents % 100);
+    return text;
+}
+
+// Order history export. The columnar format stores each row group's columns contiguously:
+//   file       = "ORDCOL02", row groups, dictionary, footer
+//   row group  = u32 rows, u32 items, i64 id[rows], i32 table[rows], i32 worker[rows],
+//                i64 arrivalUs[rows], i64 completedUs[rows], i64 deadlineUs[rows],
+//                i32 revenueCents[rows], u32 itemOffsets[rows + 1], u8 itemCodes[items]
+//   dictionary = u32 size, per entry (u16 length, name bytes)
+//   footer     = u64 rowGroupOffset[groups], u64 dictionaryOffset, u32 groups,
+//                u64 totalRows, "ORDCOL02"
+// Item codes are MenuItem values. Dictionary entry i holds the names item i was sold under (see
+// SoldItemNames), which is why the dictionary is written after the row groups. Revenue is what
+// the order was sold for on its own menu version. Timestamps are microseconds since the Unix
+// epoch and integers are little-endian. Rows are buffered one row group at a time, so memory
+// stays bounded however long the history is.
+const size_t EXPORT_ROW_GROUP = 1 << 16;   // Rows per row group
+const char EXPORT_MAGIC[8] = { 'O', 'R', 'D', 'C', 'O', 'L', '0', '2' };
+
+// Function to convert a steady-clock time to Unix microseconds, given the offset between the two
+// clocks (0 if the time is unset)
+long long unixMicros(chrono::steady_clock::time_point t, long long clockOffsetUs) {
+    if (t.time_since_epoch().count() == 0)
+        return 0;
+    return chrono::duration_cast<chrono::microseconds>(t.time_since_epoch()).count() + clockOffsetUs;
+}
+
+// Function to check whether an export path asks for CSV (it ends in ".csv")
+bool isCsvPath(const string& path) {
+    return path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+}
+
+// Function to check a shown item name from the config or menu file: CSV exports list an order's
+// items separated by ';', so a name may not contain one (nor a quote)
+bool isItemName(const string& name) {
+    return !name.empty() && name.find_first_of(";\"") == string::npos;
+}
+
+// Function to quote a CSV field as RFC 4180 does, if it holds a comma, a quote or a line break
+string csvField(const string& text) {
+    if (text.find_first_of(",\"\r\n") == string::npos)
+        return text;
+    string quoted = "\"";
+    for (char c : text) {
+        if (c == '"')
+            quoted += '"';
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+// Structure to stream orders into a columnar file or a CSV file
+struct OrderExporter {
+    FILE* file = nullptr;                  // Output file
+    bool csv = false;                      // CSV instead of columnar
+    long long clockOffsetUs = 0;           // Unix time minus steady time, in microseconds
+    vector<long long> ids, arrivals, completions, deadlines; // Columns of the open row group
+    vector<int> tableColumn, workers, revenues;
+    vector<uint32_t> itemOffsets;
+    vector<uint8_t> itemCodes;
+    vector<uint64_t> rowGroupOffsets;      // File offset of every written row group
+    SoldItemNames itemNames;               // Names the exported items were sold under
+    uint64_t bytesWritten = 0;             // Columnar bytes written so far
+    unsigned long long totalRows = 0;      // Rows written so far
+    vector<char> ioBuffer;                 // stdio buffer, large enough for sequential writes
+
+    // Function to write raw bytes to the columnar file
+    void put(const void* data, size_t bytes) {
+        fwrite(data, 1, bytes, file);
+        bytesWritten += bytes;
+    }
+
+    // Function to open 'path'; returns false if it cannot be created
+    bool open(const string& path, bool asCsv) {
+        file = fopen(path.c_str(), "wb");
+        if (file == nullptr)
+            return false;
+        csv = asCsv;
+        ioBuffer.resize(1 << 20);
+        setvbuf(file, ioBuffer.data(), _IOFBF, ioBuffer.size());
+        clockOffsetUs = chrono::duration_cast<chrono::microseconds>(chrono::system_clock::now().time_since_epoch()).count()
+            - chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+        if (csv) {
+            fputs("order_id,table,worker,arrival_us,completed_us,deadline_us,revenue_cents,items\n", file);
+            return true;
+        }
+        put(EXPORT_MAGIC, sizeof(EXPORT_MAGIC));
+        size_t groupCapacity = EXPORT_ROW_GROUP;
+        ids.reserve(groupCapacity);
+        arrivals.reserve(groupCapacity);
+        completions.reserve(groupCapacity);
+        deadlines.reserve(groupCapacity);
+        tableColumn.reserve(groupCapacity);
+        workers.reserve(groupCapacity);
+        revenues.reserve(groupCapacity);
+        itemOffsets.reserve(groupCapacity + 1);
+        itemCodes.reserve(4 * groupCapacity);
+        itemOffsets.push_back(0);
+        return true;
+    }
+
+    // Function to append one order
+    void append(const Order& order) {
+        totalRows++;
+        if (csv) {
+            fprintf(file, "%lld,%d,%d,%lld,%lld,%lld,%lld,", order.orderID, order.table, order.workerID,
+                unixMicros(order.arrivalTime, clockOffsetUs), unixMicros(order.completedTime, clockOffsetUs),
+                unixMicros(order.deadline, clockOffsetUs), orderRevenueCents(order));
+            // Item names are ';'-separated, which is why a name may not contain ';' (see isItemName)
+            string items;
+            for (size_t i = 0; i < order.foods.size(); ++i)
+                items += (i > 0 ? ";" : "") + string(soldItemName(order, order.foods[i]));
+            fprintf(file, "%s\n", csvField(items).c_str());
+            return;
+        }
+        ids.push_back(order.orderID);
+        tableColumn.push_back(order.table);
+        workers.push_back(order.workerID);
+        arrivals.push_back(unixMicros(order.arrivalTime, clockOffsetUs));
+        completions.push_back(unixMicros(order.completedTime, clockOffsetUs));
+        deadlines.push_back(unixMicros(order.deadline, clockOffsetUs));
+        revenues.push_back((int)orderRevenueCents(order));
+        itemNames.add(order);
+        for (MenuItem food : order.foods)
+            itemCodes.push_back((uint8_t)food);
+        itemOffsets.push_back((uint32_t)itemCodes.size());
+        if (ids.size() == EXPORT_ROW_GROUP)
+            flushRowGroup();
+    }
+
+    // Function to write the buffered rows as one row group
+    void flushRowGroup() {
+        if (ids.empty())
+            return;
+        rowGroupOffsets.push_back(bytesWritten);
+        uint32_t rows = (uint32_t)ids.size(), items = (uint32_t)itemCodes.size();
+        put(&rows, sizeof(rows));
+        put(&items, sizeof(items));
+        put(ids.data(), sizeof(long long) * rows);
+        put(tableColumn.data(), sizeof(int) * rows);
+        put(workers.data(), sizeof(int) * rows);
+        put(arrivals.data(), sizeof(long long) * rows);
+        put(completions.data(), sizeof(long long) * rows);
+        put(deadlines.data(), sizeof(long long) * rows);
+        put(revenues.data(), sizeof(int) * rows);
+        put(itemOffsets.data(), sizeof(uint32_t) * (rows + 1));
+        put(itemCodes.data(), items);
+        ids.clear();
+        tableColumn.clear();
+        workers.clear();
+        arrivals.clear();
+        completions.clear();
+        deadlines.clear();
+        revenues.clear();
+        itemCodes.clear();
+        itemOffsets.assign(1, 0);
+    }
+
+    // Function to write the footer and close the file; returns false on a write error
+    bool close() {
+        if (!csv) {
+            flushRowGroup();
+            uint64_t dictionaryOffset = bytesWritten;
+            uint32_t dictionarySize = ITEM_COUNT;
+            put(&dictionarySize, sizeof(dictionarySize));
+            for (const auto& label : itemNames.labels()) {
+                uint16_t length = (uint16_t)min<size_t>(label.size(), UINT16_MAX);
+                put(&length, sizeof(length));
+                put(label.data(), length);
+            }
+            put(rowGroupOffsets.data(), sizeof(uint64_t) * rowGroupOffsets.size());
+            put(&dictionaryOffset, sizeof(dictionaryOffset));
+            uint32_t groups = (uint32_t)rowGroupOffsets.size();
+            put(&groups, sizeof(groups));
+            put(&totalRows, sizeof(totalRows));
+            put(EXPORT_MAGIC, sizeof(EXPORT_MAGIC));
+        }
+        bool ok = !ferror(file);
+        return fclose(file) == 0 && ok;
+    }
+};
+
+// Function to export completed orders; a path ending in ".csv" selects CSV, anything else the
+// columnar format. Call once the kitchen has drained.
+bool exportOrderHistory(const string& path, const vector<Order>& orders) {
+    bool asCsv = isCsvPath(path);
+    OrderExporter exporter;
+    if (!exporter.open(path, asCsv)) {
+        cout << "Could not create " << path << "\n";
+        return false;
+    }
+    for (const auto& order : orders)
+        exporter.append(order);
+    bool ok = exporter.close();
+    cout << (ok ? "Order history written to " : "Failed writing order history to ") << path << " ("
+        << orders.size() << " orders, " << (asCsv ? "CSV" : "columnar") << ")\n";
+    return ok;
+}
+
+// Function to fill 'order' with the synthetic completed order number 'row' (for benchmarks)
+void makeSyntheticOrder(Order& order, long long row, mt19937& rng, chrono::steady_clock::time_point start) {
+    order.orderID = row + 1;
+    order.table = 1 + (int)(rng() % 5);
+    order.workerID = 1 + (int)(rng() % 4);
+    order.isCompleted = true;
+    order.arrivalTime = start + chrono::milliseconds(row);
+    order.completedTime = order.arrivalTime + chrono::milliseconds(200 + rng() % 2000);
+    order.deadline = order.arrivalTime + chrono::milliseconds(1500);
+    order.foods.clear();
+    for (int j = 1 + (int)(rng() % 3); j > 0; --j)
+        order.foods.push_back(MenuItem(rng() % ITEM_COUNT));
+}
+
+// Function to measure export throughput: streams 'rowCount' synthetic orders to 'path'
+int runExportBenchmark(long long rowCount, const string& path) {
+    bool asCsv = isCsvPath(path);
+    OrderExporter exporter;
+    if (!exporter.open(path, asCsv)) {
+        cout << "Could not create " << path << "\n";
+        return 1;
+    }
+    mt19937 rng(5);
+    Order order;
+    auto start = chrono::steady_clock::now();
+    for (long long row = 0; row < rowCount; ++row) {
+        makeSyntheticOrder(order, row, rng, start);
+        exporter.append(order);
+    }
+    bool ok = exporter.close();
+    double seconds = max(1e-6, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+    ifstream written(path, ios::binary | ios::ate);
+    double megabytes = written ? (double)written.tellg() / (1 << 20) : 0.0;
+    cout << "Exported " << rowCount << " orders (" << (asCsv ? "CSV" : "columnar") << ", " << megabytes
+        << " MB) in " << seconds << " s: " << megabytes / seconds << " MB/s, " << (long long)(rowCount / seconds)
+        << " orders/s\n";
+    return ok ? 0 : 1;
+}
+
+// End-of-day reports run over order history in columnar form, one row group at a time, using
+// vectorised kernels: a filtered sum, group-by over small integer keys, item counts over the
+// dictionary codes, and histograms. Each kernel has a scalar version and an AVX2 version; the
+// AVX2 set is chosen at startup when the CPU supports it. Both produce identical results.
+const int REPORT_MAX_KEYS = 64;            // Table and worker numbers tracked (higher share the last, shown as "T63+")
+const int REPORT_SERVICE_BUCKETS = 1024;   // Service-time histogram buckets
+const int REPORT_SERVICE_BUCKET_MS = 10;   // Width of one service-time bucket
+
+// Structure to represent a row group of order history as report columns
+struct OrderColumns {
+    vector<int32_t> table;                 // Table number (0 if none)
+    vector<int32_t> worker;                // Worker ID
+    vector<int32_t> serviceMs;             // Completion minus arrival
+    vector<int32_t> latenessMs;            // Completion minus deadline (negative = on time)
+    vector<int32_t> minuteOfDay;           // Completion minute of the day (UTC)
+    vector<int32_t> revenueCents;          // What the order was sold for
+    vector<uint8_t> itemCodes;             // Items of all rows, as menu dictionary codes
+    int tableKeys = 1;                     // One more than the highest table number
+    int workerKeys = 1;                    // One more than the highest worker ID
+
+    // Function to append one row; times are Unix microseconds
+    void addRow(int tableNumber, int workerID, long long arrivalUs, long long completedUs, long long deadlineUs, int revenue) {
+        auto clampKey = [](int key) { return min(max(key, 0), REPORT_MAX_KEYS - 1); };
+        auto clampMs = [](long long us) { return (int32_t)max<long long>(INT32_MIN, min<long long>(INT32_MAX, us / 1000)); };
+        table.push_back(clampKey(tableNumber));
+        worker.push_back(clampKey(workerID));
+        tableKeys = max(tableKeys, table.back() + 1);
+        workerKeys = max(workerKeys, worker.back() + 1);
+        serviceMs.push_back(max(0, clampMs(completedUs - arrivalUs)));
+        latenessMs.push_back(deadlineUs == 0 ? INT32_MIN : clampMs(completedUs - deadlineUs));
+        minuteOfDay.push_back((int32_t)((completedUs / 60000000) % (24 * 60)));
+        revenueCents.push_back(revenue);
+    }
+
+    // Function to empty the columns for the next row group
+    void clear() {
+        table.clear();
+        worker.clear();
+        serviceMs.clear();
+        latenessMs.clear();
+        minuteOfDay.clear();
+        revenueCents.clear();
+        itemCodes.clear();
+        tableKeys = workerKeys = 1;
+    }
+};
+
+// Structure to represent the accumulated end-of-day report
+struct EndOfDayReport {
+    long long orders = 0;                                   // Orders covered
+    long long revenueCents = 0;                             // What those orders were sold for
+    long long itemCounts[ITEM_COUNT] = {};                  // Items sold, per menu item
+    long long tableOrders[REPORT_MAX_KEYS] = {};            // Orders per table
+    long long tableServiceMs[REPORT_MAX_KEYS] = {};         // Total service time per table
+    long long workerOrders[REPORT_MAX_KEYS] = {};           // Orders per worker
+    long long workerServiceMs[REPORT_MAX_KEYS] = {};        // Total service time per worker
+    long long lateOrders = 0;                               // Orders completed after their deadline
+    long long latenessMs = 0;                               // Total lateness of those orders
+    long long serviceHistogram[REPORT_SERVICE_BUCKETS] = {}; // Orders per service-time bucket
+    long long hourHistogram[24] = {};                       // Completions per hour of the day
+
+    bool operator==(const EndOfDayReport& other) const { return memcmp(this, &other, sizeof(*this)) == 0; }
+};
+
+// Structure to represent one implementation of the report kernels
+struct ReportKernels {
+    const char* name;
+    // Sum of values above 'threshold'; their count goes to 'count'
+    long long (*sumAbove)(const int32_t* values, size_t n, int32_t threshold, long long* count);
+    // Per-key count and sum of values, for keys in [0, keyCount)
+    void (*groupSum)(const int32_t* keys, const int32_t* values, size_t n, int keyCount, long long* counts, long long* sums);
+    // Per-code count, for codes in [0, codeCount)
+    void (*countCodes)(const uint8_t* codes, size_t n, int codeCount, long long* counts);
+    // Histogram with bucket = (int)(value * (1.0f / width)), clamped to [0, bucketCount)
+    void (*histogram)(const int32_t* values, size_t n, int width, int bucketCount, long long* buckets);
 };
 
-// Structure to represent worker credentials
-struct WorkerCredential {
-    int workerId;              // Unique ID for the worker
-    string fullName;           // Full name of the worker
-    string password;           // Password for the worker
-    int defaultTask;           // Default task assigned to the worker
-};
+long long sumAboveScalar(const int32_t* values, size_t n, int32_t threshold, long long* count) {
+    long long sum = 0, matches = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (values[i] > threshold) {
+            sum += values[i];
+            matches++;
+        }
+    }
+    *count += matches;
+    return sum;
+}
+
+void groupSumScalar(const int32_t* keys, const int32_t* values, size_t n, int, long long* counts, long long* sums) {
+    for (size_t i = 0; i < n; ++i) {
+        counts[keys[i]]++;
+        sums[keys[i]] += values[i];
+    }
+}
+
+void countCodesScalar(const uint8_t* codes, size_t n, int codeCount, long long* counts) {
+    for (size_t i = 0; i < n; ++i)
+        if (codes[i] < codeCount)
+            counts[codes[i]]++;
+}
+
+// Function to compute the histogram bucket of a value; the AVX2 kernel does the same arithmetic
+inline int histogramBucket(int32_t value, float scale, int bucketCount) {
+    int bucket = (int)((float)value * scale);
+    return min(max(bucket, 0), bucketCount - 1);
+}
+
+void histogramScalar(const int32_t* values, size_t n, int width, int bucketCount, long long* buckets) {
+    float scale = 1.0f / (float)width;
+    for (size_t i = 0; i < n; ++i)
+        buckets[histogramBucket(values[i], scale, bucketCount)]++;
+}
+
+const ReportKernels scalarKernels = { "scalar", sumAboveScalar, groupSumScalar, countCodesScalar, histogramScalar };
+
+#ifdef KITCHEN_AVX2
+// Function to add the four 64-bit lanes of a vector
+AVX2_TARGET inline long long horizontalSum64(__m256i v) {
+    alignas(32) long long lanes[4];
+    _mm256_store_si256((__m256i*)lanes, v);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+// Function to add eight 32-bit lanes to a pair of 64-bit accumulators
+AVX2_TARGET inline void accumulateWide(__m256i v, __m256i& low, __m256i& high) {
+    low = _mm256_add_epi64(low, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v)));
+    high = _mm256_add_epi64(high, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v, 1)));
+}
+
+AVX2_TARGET long long sumAboveAvx2(const int32_t* values, size_t n, int32_t threshold, long long* count) {
+    __m256i limit = _mm256_set1_epi32(threshold);
+    __m256i low = _mm256_setzero_si256(), high = _mm256_setzero_si256(), matches = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(values + i));
+        __m256i mask = _mm256_cmpgt_epi32(v, limit);
+        accumulateWide(_mm256_and_si256(v, mask), low, high);
+        accumulateWide(_mm256_sub_epi32(_mm256_setzero_si256(), mask), matches, matches);
+    }
+    long long sum = horizontalSum64(_mm256_add_epi64(low, high));
+    *count += horizontalSum64(matches);
+    return sum + sumAboveScalar(values + i, n - i, threshold, count);
+}
+
+// Function to group-sum whole blocks of eight rows for a fixed key count; returns the rows done.
+// Each key compares the eight keys of a block at once and accumulates in 32-bit lanes. Values
+// are split into an unsigned low half and a signed high half so neither sum can wrap within
+// 32768 blocks, after which the lanes are folded into the 64-bit totals.
+template <int KEYS>
+AVX2_TARGET size_t groupSumBlocksAvx2(const int32_t* keys, const int32_t* values, size_t n, long long* counts, long long* sums) {
+    const size_t FLUSH_BLOCKS = 1 << 15;
+    __m256i lowMask = _mm256_set1_epi32(0xFFFF);
+    alignas(32) uint32_t lanes[8];
+    size_t i = 0;
+    while (i + 8 <= n) {
+        __m256i low[KEYS], high[KEYS], hits[KEYS];
+        for (int k = 0; k < KEYS; ++k)
+            low[k] = high[k] = hits[k] = _mm256_setzero_si256();
+        size_t end = i + min<size_t>((n - i) & ~(size_t)7, FLUSH_BLOCKS * 8);
+        for (; i < end; i += 8) {
+            __m256i key = _mm256_loadu_si256((const __m256i*)(keys + i));
+            __m256i v = _mm256_loadu_si256((const __m256i*)(values + i));
+            __m256i valueLow = _mm256_and_si256(v, lowMask), valueHigh = _mm256_srai_epi32(v, 16);
+            for (int k = 0; k < KEYS; ++k) {
+                __m256i mask = _mm256_cmpeq_epi32(key, _mm256_set1_epi32(k));
+                low[k] = _mm256_add_epi32(low[k], _mm256_and_si256(valueLow, mask));
+                high[k] = _mm256_add_epi32(high[k], _mm256_and_si256(valueHigh, mask));
+                hits[k] = _mm256_sub_epi32(hits[k], mask);
+            }
+        }
+        for (int k = 0; k < KEYS; ++k) {
+            long long lowSum = 0, highSum = 0, hitCount = 0;
+            _mm256_store_si256((__m256i*)lanes, low[k]);
+            for (uint32_t lane : lanes)
+                lowSum += lane;
+            _mm256_store_si256((__m256i*)lanes, high[k]);
+            for (uint32_t lane : lanes)
+                highSum += (int32_t)lane;
+            _mm256_store_si256((__m256i*)lanes, hits[k]);
+            for (uint32_t lane : lanes)
+                hitCount += lane;
+            sums[k] += highSum * 65536 + lowSum;
+            counts[k] += hitCount;
+        }
+    }
+    return i;
+}
+
+AVX2_TARGET void groupSumAvx2(const int32_t* keys, const int32_t* values, size_t n, int keyCount, long long* counts, long long* sums) {
+    // The key count is a template argument so the accumulators can stay in registers; wider key
+    // ranges (more workers than that) are left to the scalar loop, which indexes the totals directly
+    size_t i = 0;
+    switch (keyCount) {
+    case 1: i = groupSumBlocksAvx2<1>(keys, values, n, counts, sums); break;
+    case 2: i = groupSumBlocksAvx2<2>(keys, values, n, counts, sums); break;
+    case 3: i = groupSumBlocksAvx2<3>(keys, values, n, counts, sums); break;
+    case 4: i = groupSumBlocksAvx2<4>(keys, values, n, counts, sums); break;
+    case 5: i = groupSumBlocksAvx2<5>(keys, values, n, counts, sums); break;
+    case 6: i = groupSumBlocksAvx2<6>(keys, values, n, counts, sums); break;
+    case 7: i = groupSumBlocksAvx2<7>(keys, values, n, counts, sums); break;
+    case 8: i = groupSumBlocksAvx2<8>(keys, values, n, counts, sums); break;
+    default: break;
+    }
+    groupSumScalar(keys + i, values + i, n - i, keyCount, counts, sums);
+}
+
+AVX2_TARGET void countCodesAvx2(const uint8_t* codes, size_t n, int codeCount, long long* counts) {
+    const int MAX_VECTOR_CODES = 16;
+    if (codeCount > MAX_VECTOR_CODES) {
+        countCodesScalar(codes, n, codeCount, counts);
+        return;
+    }
+    // Byte counters are bumped by subtracting the compare mask and folded into 64-bit totals
+    // with a sum of absolute differences before they can wrap (every 255 blocks)
+    __m256i bytes[MAX_VECTOR_CODES], totals[MAX_VECTOR_CODES];
+    for (int c = 0; c < codeCount; ++c)
+        bytes[c] = totals[c] = _mm256_setzero_si256();
+    size_t i = 0;
+    int pending = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i*)(codes + i));
+        for (int c = 0; c < codeCount; ++c)
+            bytes[c] = _mm256_sub_epi8(bytes[c], _mm256_cmpeq_epi8(block, _mm256_set1_epi8((char)c)));
+        if (++pending == 255) {
+            for (int c = 0; c < codeCount; ++c) {
+                totals[c] = _mm256_add_epi64(totals[c], _mm256_sad_epu8(bytes[c], _mm256_setzero_si256()));
+                bytes[c] = _mm256_setzero_si256();
+            }
+            pending = 0;
+        }
+    }
+    for (int c = 0; c < codeCount; ++c) {
+        totals[c] = _mm256_add_epi64(totals[c], _mm256_sad_epu8(bytes[c], _mm256_setzero_si256()));
+        counts[c] += horizontalSum64(totals[c]);
+    }
+    countCodesScalar(codes + i, n - i, codeCount, counts);
+}
+
+AVX2_TARGET void histogramAvx2(const int32_t* values, size_t n, int width, int bucketCount, long long* buckets) {
+    // Bucket indices are computed eight at a time; the increments stay scalar (AVX2 has no
+    // scatter) and go to four interleaved copies of the histogram, so runs of equal values do
+    // not serialise on one counter
+    float scale = 1.0f / (float)width;
+    __m256 scaleVector = _mm256_set1_ps(scale);
+    __m256i lastBucket = _mm256_set1_epi32(bucketCount - 1);
+    __m256i copyOffset = _mm256_setr_epi32(0, 1, 2, 3, 0, 1, 2, 3);
+    vector<uint32_t> copies(4 * (size_t)bucketCount, 0);
+    size_t i = 0;
+    while (i + 8 <= n) {
+        // Flush before a 32-bit counter could wrap
+        size_t end = i + min<size_t>((n - i) & ~(size_t)7, (size_t)1 << 30);
+        for (; i < end; i += 8) {
+            __m256 v = _mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i*)(values + i)));
+            __m256i bucket = _mm256_cvttps_epi32(_mm256_mul_ps(v, scaleVector));
+            bucket = _mm256_max_epi32(_mm256_min_epi32(bucket, lastBucket), _mm256_setzero_si256());
+            // Lanes are extracted from registers: reloading a wide store lane by lane stalls
+            __m256i index = _mm256_add_epi32(_mm256_slli_epi32(bucket, 2), copyOffset);
+            __m128i low = _mm256_castsi256_si128(index), high = _mm256_extracti128_si256(index, 1);
+            copies[_mm_cvtsi128_si32(low)]++;
+            copies[_mm_extract_epi32(low, 1)]++;
+            copies[_mm_extract_epi32(low, 2)]++;
+            copies[_mm_extract_epi32(low, 3)]++;
+            copies[_mm_cvtsi128_si32(high)]++;
+            copies[_mm_extract_epi32(high, 1)]++;
+            copies[_mm_extract_epi32(high, 2)]++;
+            copies[_mm_extract_epi32(high, 3)]++;
+        }
+        for (int b = 0; b < bucketCount; ++b) {
+            buckets[b] += (long long)copies[4 * b] + copies[4 * b + 1] + copies[4 * b + 2] + copies[4 * b + 3];
+            copies[4 * b] = copies[4 * b + 1] = copies[4 * b + 2] = copies[4 * b + 3] = 0;
+        }
+    }
+    histogramScalar(values + i, n - i, width, bucketCount, buckets);
+}
+
+const ReportKernels avx2Kernels = { "AVX2", sumAboveAvx2, groupSumAvx2, countCodesAvx2, histogramAvx2 };
+#endif
+
+// Function to pick the fastest kernels this CPU supports
+const ReportKernels& selectReportKernels() {
+#ifdef KITCHEN_AVX2
+    if (__builtin_cpu_supports("avx2"))
+        return avx2Kernels;
+#endif
+    return scalarKernels;
+}
+
+// Function to fold one row group into the report
+void accumulateReport(const OrderColumns& columns, const ReportKernels& kernels, EndOfDayReport& report) {
+    size_t n = columns.table.size();
+    report.orders += (long long)n;
+    long long sold = 0;
+    report.revenueCents += kernels.sumAbove(columns.revenueCents.data(), n, INT32_MIN, &sold); // Every row
+    kernels.countCodes(columns.itemCodes.data(), columns.itemCodes.size(), ITEM_COUNT, report.itemCounts);
+    kernels.groupSum(columns.table.data(), columns.serviceMs.data(), n, columns.tableKeys,
+        report.tableOrders, report.tableServiceMs);
+    kernels.groupSum(columns.worker.data(), columns.serviceMs.data(), n, columns.workerKeys,
+        report.workerOrders, report.workerServiceMs);
+    report.latenessMs += kernels.sumAbove(columns.latenessMs.data(), n, 0, &report.lateOrders);
+    kernels.histogram(columns.serviceMs.data(), n, REPORT_SERVICE_BUCKET_MS, REPORT_SERVICE_BUCKETS, report.serviceHistogram);
+    kernels.histogram(columns.minuteOfDay.data(), n, 60, 24, report.hourHistogram);
+}
+
+// Function to compute the same report with a plain loop over Order structs
+void naiveReport(const vector<Order>& orders, long long clockOffsetUs, EndOfDayReport& report) {
+    float serviceScale = 1.0f / REPORT_SERVICE_BUCKET_MS, hourScale = 1.0f / 60;
+    for (const auto& order : orders) {
+        long long arrivalUs = unixMicros(order.arrivalTime, clockOffsetUs);
+        long long completedUs = unixMicros(order.completedTime, clockOffsetUs);
+        int serviceMs = (int)max<long long>(0, (completedUs - arrivalUs) / 1000);
+        int latenessMs = (int)((completedUs - unixMicros(order.deadline, clockOffsetUs)) / 1000);
+        int table = min(max(order.table, 0), REPORT_MAX_KEYS - 1), worker = min(max(order.workerID, 0), REPORT_MAX_KEYS - 1);
+        report.orders++;
+        report.revenueCents += orderRevenueCents(order);
+        for (MenuItem food : order.foods)
+            report.itemCounts[food]++;
+        report.tableOrders[table]++;
+        report.tableServiceMs[table] += serviceMs;
+        report.workerOrders[worker]++;
+        report.workerServiceMs[worker] += serviceMs;
+        if (latenessMs > 0) {
+            report.lateOrders++;
+            report.latenessMs += latenessMs;
+        }
+        report.serviceHistogram[histogramBucket(serviceMs, serviceScale, REPORT_SERVICE_BUCKETS)]++;
+        report.hourHistogram[histogramBucket((int)((completedUs / 60000000) % (24 * 60)), hourScale, 24)]++;
+    }
+}
+
+// Function to get a service-time percentile (in ms, bucket upper bound) from the histogram
+long long servicePercentile(const EndOfDayReport& report, double fraction) {
+    long long target = (long long)(fraction * report.orders), seen = 0;
+    for (int b = 0; b < REPORT_SERVICE_BUCKETS; ++b) {
+        seen += report.serviceHistogram[b];
+        if (seen > target)
+            return (long long)(b + 1) * REPORT_SERVICE_BUCKET_MS;
+    }
+    return (long long)REPORT_SERVICE_BUCKETS * REPORT_SERVICE_BUCKET_MS;
+}
+
+// Function to print an end-of-day report; 'itemLabels' names each item as it was sold
+void printEndOfDayReport(const EndOfDayReport& report, const vector<string>& itemLabels) {
+    cout << "\n=== End-of-Day Report (" << report.orders << " orders) ===\n";
+    cout << "Items:";
+    for (int i = 0; i < ITEM_COUNT; ++i)
+        cout << " " << itemLabels[i] << " " << report.itemCounts[i];
+    cout << "\nRevenue: " << formatCents(report.revenueCents) << "\nTables (orders, avg service ms):";
+    for (int t = 1; t < REPORT_MAX_KEYS; ++t)
+        if (report.tableOrders[t] > 0)
+            cout << " T" << t << (t == REPORT_MAX_KEYS - 1 ? "+" : "") << " " << report.tableOrders[t] << " (" << report.tableServiceMs[t] / report.tableOrders[t] << ")";
+    cout << "\nWorkers (orders, avg service ms):";
+    for (int w = 0; w < REPORT_MAX_KEYS; ++w)
+        if (report.workerOrders[w] > 0)
+            cout << " #" << w << (w == REPORT_MAX_KEYS - 1 ? "+" : "") << " " << report.workerOrders[w] << " (" << report.workerServiceMs[w] / report.workerOrders[w] << ")";
+    cout << "\nService time: p50 " << servicePercentile(report, 0.50) << " ms, p95 " << servicePercentile(report, 0.95)
+        << " ms\nLate: " << report.lateOrders << " orders, " << report.latenessMs << " ms total lateness\nBusiest hours (UTC):";
+    for (int h = 0; h < 24; ++h)
+        if (report.hourHistogram[h] > 0)
+            cout << " " << h << "h " << report.hourHistogram[h];
+    cout << "\n";
+}
+
+// Function to read a columnar export row group by row group and print its end-of-day report
+int runColumnarReport(const string& path) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        cout << "Could not open " << path << "\n";
+        return 1;
+    }
+    auto readExact = [file](void* data, size_t bytes) { return fread(data, 1, bytes, file) == bytes; };
+    char magic[sizeof(EXPORT_MAGIC)];
+    bool ok = readExact(magic, sizeof(magic)) && memcmp(magic, EXPORT_MAGIC, sizeof(magic)) == 0;
+
+    // The footer ends with the group count, the row count and the magic; before them come the
+    // row group offsets and the dictionary offset. Every count and offset is checked against the
+    // file size before anything is allocated or sought, so a truncated or corrupt file is rejected.
+    uint32_t groups = 0;
+    uint64_t dictionaryOffset = 0;
+    vector<uint64_t> offsets;
+    const long footerTail = (long)(sizeof(uint32_t) + sizeof(uint64_t) + sizeof(EXPORT_MAGIC));
+    const long offsetTail = footerTail + (long)sizeof(uint64_t);
+    long fileSize = ok && fseek(file, 0, SEEK_END) == 0 ? ftell(file) : -1;
+    ok = ok && fileSize >= (long)sizeof(EXPORT_MAGIC) + offsetTail;
+    ok = ok && fseek(file, -footerTail, SEEK_END) == 0 && readExact(&groups, sizeof(groups));
+    ok = ok && fseek(file, -offsetTail, SEEK_END) == 0 && readExact(&dictionaryOffset, sizeof(dictionaryOffset));
+    // End of the dictionary, where the row group offsets start
+    uint64_t footerStart = ok ? (uint64_t)(fileSize - offsetTail) - (uint64_t)groups * sizeof(uint64_t) : 0;
+    ok = ok && (uint64_t)groups * sizeof(uint64_t) <= (uint64_t)(fileSize - offsetTail) - sizeof(EXPORT_MAGIC)
+        && dictionaryOffset >= sizeof(EXPORT_MAGIC) && dictionaryOffset + sizeof(uint32_t) <= footerStart;
+    if (ok)
+        offsets.resize(groups);
+    ok = ok && fseek(file, (long)footerStart, SEEK_SET) == 0 && readExact(offsets.data(), groups * sizeof(uint64_t));
+
+    // Item code i is labelled with dictionary entry i
+    uint32_t dictionarySize = 0;
+    vector<string> itemLabels = SoldItemNames().labels();
+    ok = ok && fseek(file, (long)dictionaryOffset, SEEK_SET) == 0 && readExact(&dictionarySize, sizeof(dictionarySize));
+    ok = ok && (uint64_t)dictionarySize * sizeof(uint16_t) <= footerStart - dictionaryOffset - sizeof(uint32_t);
+    for (uint32_t d = 0; ok && d < dictionarySize; ++d) {
+        uint16_t length = 0;
+        string name;
+        ok = readExact(&length, sizeof(length));
+        name.resize(length);
+        ok = ok && readExact(&name[0], length);
+        if (ok && d < (uint32_t)ITEM_COUNT)
+            itemLabels[d] = name;
+    }
+
+    const ReportKernels& kernels = selectReportKernels();
+    EndOfDayReport report;
+    OrderColumns columns;
+    vector<long long> ids, arrivals, completions, deadlines;
+    vector<int32_t> tableColumn, workers, revenues;
+    vector<uint32_t> itemOffsets;
+    double kernelSeconds = 0;
+    for (uint32_t g = 0; ok && g < groups; ++g) {
+        uint32_t rows = 0, items = 0;
+        const uint64_t headerBytes = 2 * sizeof(uint32_t);
+        ok = offsets[g] >= sizeof(EXPORT_MAGIC) && offsets[g] + headerBytes <= dictionaryOffset
+            && fseek(file, (long)offsets[g], SEEK_SET) == 0 && readExact(&rows, sizeof(rows)) && readExact(&items, sizeof(items));
+        // The group's columns must fit before the dictionary
+        uint64_t groupBytes = headerBytes + (uint64_t)rows * (4 * sizeof(long long) + 3 * sizeof(int32_t))
+            + ((uint64_t)rows + 1) * sizeof(uint32_t) + items;
+        ok = ok && rows <= EXPORT_ROW_GROUP && groupBytes <= dictionaryOffset - offsets[g];
+        if (!ok)
+            break;
+        ids.resize(rows);
+        tableColumn.resize(rows);
+        workers.resize(rows);
+        arrivals.resize(rows);
+        completions.resize(rows);
+        deadlines.resize(rows);
+        revenues.resize(rows);
+        itemOffsets.resize(rows + 1);
+        columns.clear();
+        columns.itemCodes.resize(items);
+        ok = readExact(ids.data(), rows * sizeof(long long)) && readExact(tableColumn.data(), rows * sizeof(int32_t))
+            && readExact(workers.data(), rows * sizeof(int32_t)) && readExact(arrivals.data(), rows * sizeof(long long))
+            && readExact(completions.data(), rows * sizeof(long long)) && readExact(deadlines.data(), rows * sizeof(long long))
+            && readExact(revenues.data(), rows * sizeof(int32_t))
+            && readExact(itemOffsets.data(), (rows + 1) * sizeof(uint32_t)) && readExact(columns.itemCodes.data(), items);
+        for (auto& code : columns.itemCodes)
+            code = code < min(dictionarySize, (uint32_t)ITEM_COUNT) ? code : UINT8_MAX;
+        for (uint32_t r = 0; ok && r < rows; ++r)
+            columns.addRow(tableColumn[r], workers[r], arrivals[r], completions[r], deadlines[r], revenues[r]);
+        auto start = chrono::steady_clock::now();
+        accumulateReport(columns, kernels, report);
+        kernelSeconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+    fclose(file);
+    if (!ok) {
+        cout << path << " is not a readable columnar order export.\n";
+        return 1;
+    }
+    printEndOfDayReport(report, itemLabels);
+    cout << "Kernels: " << kernels.name << ", " << groups << " row groups, " << kernelSeconds * 1000 << " ms\n";
+    return 0;
+}
+
+// Function to benchmark the report kernels against a naive loop over Order structs
+int runReportBenchmark(long long rowCount) {
+    mt19937 rng(5);
+    auto start = chrono::steady_clock::now();
+    long long clockOffsetUs = chrono::duration_cast<chrono::microseconds>(chrono::system_clock::now().time_since_epoch()).count()
+        - chrono::duration_cast<chrono::microseconds>(start.time_since_epoch()).count();
+    vector<Order> orders((size_t)rowCount);
+    OrderColumns columns;
+    SoldItemNames itemNames;
+    for (long long row = 0; row < rowCount; ++row) {
+        Order& order = orders[(size_t)row];
+        makeSyntheticOrder(order, row, rng, start);
+        itemNames.add(order);
+        columns.addRow(order.table, order.workerID, unixMicros(order.arrivalTime, clockOffsetUs),
+            unixMicros(order.completedTime, clockOffsetUs), unixMicros(order.deadline, clockOffsetUs),
+            (int)orderRevenueCents(order));
+        for (MenuItem food : order.foods)
+            columns.itemCodes.push_back((uint8_t)food);
+    }
+
+    auto timeIt = [](const function<void()>& body) {
+        auto begin = chrono::steady_clock::now();
+        body();
+        return chrono::duration<double, milli>(chrono::steady_clock::now() - begin).count();
+    };
+    EndOfDayReport naive, scalar, vectorised;
+    double naiveMs = timeIt([&] { naiveReport(orders, clockOffsetUs, naive); });
+    double scalarMs = timeIt([&] { accumulateReport(columns, scalarKernels, scalar); });
+    const ReportKernels& best = selectReportKernels();
+    double bestMs = timeIt([&] { accumulateReport(columns, best, vectorised); });
+
+    printEndOfDayReport(vectorised, itemNames.labels());
+    cout << "\n=== Report Kernel Benchmark (" << rowCount << " orders) ===\n";
+    cout << "Naive loop over orders: " << naiveMs << " ms\n";
+    cout << "Columnar, scalar kernels: " << scalarMs << " ms (" << naiveMs / max(scalarMs, 1e-3) << "x)"
+        << (scalar == naive ? "" : " MISMATCH") << "\n";
+    cout << "Columnar, " << best.name << " kernels: " << bestMs << " ms (" << naiveMs / max(bestMs, 1e-3) << "x)"
+        << (vectorised == naive ? "" : " MISMATCH") << "\n";
+
+    // Per-kernel breakdown, scalar against the selected set
+    size_t n = columns.table.size();
+    for (const ReportKernels* kernels : { &scalarKernels, &best }) {
+        EndOfDayReport scratch;
+        double sumMs = timeIt([&] { kernels->sumAbove(columns.latenessMs.data(), n, 0, &scratch.lateOrders); });
+        double groupMs = timeIt([&] { kernels->groupSum(columns.table.data(), columns.serviceMs.data(), n,
+            columns.tableKeys, scratch.tableOrders, scratch.tableServiceMs); });
+        double countMs = timeIt([&] { kernels->countCodes(columns.itemCodes.data(), columns.itemCodes.size(),
+            ITEM_COUNT, scratch.itemCounts); });
+        double histogramMs = timeIt([&] { kernels->histogram(columns.serviceMs.data(), n, REPORT_SERVICE_BUCKET_MS,
+            REPORT_SERVICE_BUCKETS, scratch.serviceHistogram); });
+        cout << "  " << kernels->name << ": filtered sum " << sumMs << " ms, group-by " << groupMs
+            << " ms, item counts " << countMs << " ms, histogram " << histogramMs << " ms\n";
+    }
+    return scalar == naive && vectorised == naive ? 0 : 1;
+}
+
+// Lock instrumentation: every kitchen mutex records wait and hold times, and the order in
+// which locks are nested. A new nesting edge triggers a cycle check, so lock-order inversions
+// are reported the first time they happen rather than when they finally deadlock.
+const int MAX_TRACKED_LOCKS = 32;
+atomic<bool> lockInstrumentation(false);            // Whether locks record statistics
+atomic<int> registeredLocks(0);                     // Number of instrumented locks created
+const char* lockNames[MAX_TRACKED_LOCKS];           // Name of each instrumented lock
+atomic<bool> lockOrderEdges[MAX_TRACKED_LOCKS][MAX_TRACKED_LOCKS]; // [a][b]: b was taken while holding a
+atomic<long long> lockOrderCycles(0);               // Lock-order cycles detected
+thread_local vector<int> heldLocks;                 // Instrumented locks held by this thread, in order
+
+// Structure to represent the statistics of one instrumented lock
+struct LockStats {
+    atomic<long long> acquisitions{ 0 };  // Number of times the lock was taken
+    atomic<long long> contended{ 0 };     // Acquisitions that found the lock held
+    atomic<long long> waitNs{ 0 };        // Total time spent waiting for the lock
+    atomic<long long> maxWaitNs{ 0 };     // Longest single wait
+    atomic<long long> holdNs{ 0 };        // Total time the lock was held
+    atomic<long long> maxHoldNs{ 0 };     // Longest single hold
+};
+LockStats lockStats[MAX_TRACKED_LOCKS];
+
+// Function to raise an atomic maximum
+void atomicMax(atomic<long long>& target, long long value) {
+    long long current = target.load(memory_order_relaxed);
+    while (value > current && !target.compare_exchange_weak(current, value, memory_order_relaxed)) {
+    }
+}
+
+// Function to check whether lock 'to' can be reached from lock 'from' through nesting edges
+bool lockOrderPath(int from, int to, vector<bool>& visited) {
+    if (from == to)
+        return true;
+    visited[from] = true;
+    int count = min(registeredLocks.load(), MAX_TRACKED_LOCKS);
+    for (int next = 0; next < count; ++next) {
+        if (!visited[next] && lockOrderEdges[from][next].load(memory_order_relaxed)
+            && lockOrderPath(next, to, visited))
+            return true;
+    }
+    return false;
+}
+
+// Mutex wrapper that records contention and checks lock ordering when instrumentation is on
+class InstrumentedMutex {
+public:
+    explicit InstrumentedMutex(const char* name) {
+        id = registeredLocks++;
+        if (id < MAX_TRACKED_LOCKS)
+            lockNames[id] = name;
+        else
+            id = -1; // Too many locks: this one is not tracked
+    }
+
+    void lock() {
+        if (id < 0 || !lockInstrumentation.load(memory_order_relaxed)) {
+            inner.lock();
+            instrumentedHold = false;
+            return;
+        }
+        checkOrder();
+        LockStats& stats = lockStats[id];
+        if (!inner.try_lock()) {
+            TraceSpan waitSpan("lock wait", "lock", 0, 0, lockNames[id]);
+            auto waitStart = chrono::steady_clock::now();
+            inner.lock();
+            long long waited = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - waitStart).count();
+            stats.contended.fetch_add(1, memory_order_relaxed);
+            stats.waitNs.fetch_add(waited, memory_order_relaxed);
+            atomicMax(stats.maxWaitNs, waited);
+        }
+        stats.acquisitions.fetch_add(1, memory_order_relaxed);
+        heldLocks.push_back(id);
+        instrumentedHold = true;
+        lockedAt = chrono::steady_clock::now();
+    }
+
+    bool try_lock() {
+        if (!inner.try_lock())
+            return false;
+        instrumentedHold = false;
+        return true;
+    }
+
+    void unlock() {
+        if (instrumentedHold) {
+            long long held = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - lockedAt).count();
+            lockStats[id].holdNs.fetch_add(held, memory_order_relaxed);
+            atomicMax(lockStats[id].maxHoldNs, held);
+            auto it = find(heldLocks.rbegin(), heldLocks.rend(), id);
+            if (it != heldLocks.rend())
+                heldLocks.erase(next(it).base());
+        }
+        inner.unlock();
+    }
+
+private:
+    // Record nesting edges from every held lock to this one and report recursion or cycles
+    void checkOrder() {
+        for (int held : heldLocks) {
+            if (held == id) {
+                cerr << "\n[lock] Recursive acquisition of '" << lockNames[id]
+                    << "' would self-deadlock. Aborting.\n";
+                abort();
+            }
+            if (lockOrderEdges[held][id].load(memory_order_relaxed))
+                continue;
+            if (!lockOrderEdges[held][id].exchange(true)) {
+                vector<bool> visited(MAX_TRACKED_LOCKS, false);
+                if (lockOrderPath(id, held, visited)) {
+                    lockOrderCycles++;
+                    cerr << "\n[lock] Lock-order cycle: '" << lockNames[held] << "' -> '"
+                        << lockNames[id] << "' closes a cycle (potential deadlock).\n";
+                }
+            }
+        }
+    }
+
+    mutex inner;                                 // Underlying mutex
+    int id;                                      // Index into the instrumentation tables
+    bool instrumentedHold = false;               // Whether the current hold is being timed
+    chrono::steady_clock::time_point lockedAt;   // When the current holder acquired the lock
+};
+
+// Function to print the contention report for all instrumented locks
+void printLockReport() {
+    cout << "\n=== Lock Contention Report ===\n";
+    int count = min(registeredLocks.load(), MAX_TRACKED_LOCKS);
+    for (int i = 0; i < count; ++i) {
+        const LockStats& stats = lockStats[i];
+        long long acquisitions = stats.acquisitions;
+        if (acquisitions == 0)
+            continue;
+        cout << lockNames[i] << " #" << i << ": " << acquisitions << " acquisitions, "
+            << 100 * stats.contended / acquisitions << "% contended, wait avg "
+            << stats.waitNs / acquisitions / 1000 << " us / max " << stats.maxWaitNs / 1000
+            << " us, hold avg " << stats.holdNs / acquisitions / 1000 << " us / max "
+            << stats.maxHoldNs / 1000 << " us\n";
+    }
+    cout << "Lock order edges:";
+    for (int a = 0; a < count; ++a)
+        for (int b = 0; b < count; ++b)
+            if (lockOrderEdges[a][b])
+                cout << " " << lockNames[a] << "#" << a << "->" << lockNames[b] << "#" << b;
+    cout << "\nLock-order cycles detected: " << lockOrderCycles << "\n";
+}
+
+// Shared resources
+OrderQueue orderQueue;         // Queue to hold orders
+InstrumentedMutex queueMutex("queueMutex"); // Mutex to protect access to the order queue
+condition_variable_any cv;     // Condition variable to notify workers of new orders
+vector<bool> tables(5, true);  // Vector to track table availability (true = available)
+vector<OrderPriority> tableBoost(5, PRIORITY_NORMAL); // Class inherited by each table's holder (guarded by queueMutex)
+vector<Order> completedOrders; // List of completed orders
+vector<string> waitingList;    // List of guests in the waiting list (append-only, within the capacity reserved by sizeKitchen)
+int waitingListCapacity = 10;  // Maximum number of guests on the waiting list
+// Order IDs: bits 53-62 hold the node (shard) that issued the ID and the low 53 bits a sequence;
+// the sign bit stays clear, so node numbers go up to ORDER_ID_MAX_NODE (1023).
+// The sequence is seeded with the start time in milliseconds shifted left 12 bits, so a restarted
+// process starts above every ID its predecessor could have issued (at up to 4096 IDs per ms).
+// Intake threads lease blocks of IDs with one fetch_add, so issuing an ID takes no lock and
+// rarely touches shared memory.
+const int ORDER_ID_NODE_SHIFT = 53;        // Bits below the node number
+const int ORDER_ID_MAX_NODE = (1 << (63 - ORDER_ID_NODE_SHIFT)) - 1; // Highest node that keeps IDs positive
+const long long ORDER_ID_BLOCK = 256;      // IDs leased to a thread at a time
+atomic<long long> orderIdSequence(0);      // Next sequence value not yet leased
+atomic<int> orderIdGeneration(0);          // Bumped on reseed so threads drop stale leases
+int orderIdNode = 0;                       // Node number stamped into issued IDs
+atomic<bool> shutdownFlag(false); // Flag to signal shutdown to worker threads
+atomic<bool> intakeOpen(true);    // Whether new orders are accepted into the queue
+atomic<bool> hardStopFlag(false); // Flag to abandon remaining work at the next item boundary
+int inFlightOrders = 0;           // Orders taken by workers but not yet finished (guarded by queueMutex)
+condition_variable_any drainCv;   // Condition variable to notify the drain that the kitchen went idle
+int taskMillis = 1000;            // Simulated duration of one task step in milliseconds
+bool consoleLogging = true;       // Whether workers print per-order and per-item progress
+bool itemLogging = true;          // Whether per-item lines are printed too (when consoleLogging is on)
+atomic<long long> preemptions(0);    // Orders checkpointed back into the queue for a higher class
+atomic<long long> priorityBoosts(0); // Table holders raised to the class of an order waiting for a table
+int sliceQuantumItems = 0;           // Round-robin quantum in items (0 = no item limit)
+int sliceQuantumMillis = 0;          // Round-robin quantum in milliseconds (0 = no time limit)
+atomic<long long> sliceYields(0);    // Orders handed back to the queue when their quantum ran out
+atomic<long long> cancelledQueued(0);     // Cancelled orders skipped when dequeued
+atomic<long long> cancelledInProgress(0); // Cancelled orders stopped at an item boundary
+atomic<long long> ordersModified(0);      // Orders whose items were changed while queued
+atomic<long long> ordersUnseated(0);      // Orders dropped at closing because every free table was held for a booking
+atomic<long long> classCompleted[PRIORITY_COUNT]; // Completed orders per priority class
+atomic<long long> classLatencyMs[PRIORITY_COUNT]; // Total arrival-to-completion time per priority class
+atomic<long long> ordersOnTime(0);   // Completed orders that met their deadline
+atomic<long long> deadlineMisses(0); // Completed orders that missed their deadline
+atomic<long long> totalLatenessMs(0); // Sum of how late the missed orders were
+
+vector<WorkerCredential> workerCredentials; // List of registered workers
+set<int> usedWorkerIds;                     // Set of used worker IDs to ensure uniqueness
+
+// Worker output: each message is composed in a buffer owned by the calling thread and handed to
+// the sink in a single write, so messages from different workers never interleave mid-line and
+// no lock is held while formatting. The sink is stdout, a file, or an in-memory ring that tests
+// read back; consoleLogging switches worker output off altogether.
+enum LogSink { LOG_STDOUT, LOG_FILE, LOG_RING };
+const size_t LOG_RING_SLOTS = 1024;        // Messages kept by the ring sink
+const size_t LOG_SLOT_BYTES = 200;         // Longest message kept whole by the ring sink
+
+const size_t LOG_SLOT_WORDS = LOG_SLOT_BYTES / sizeof(unsigned long long);
+
+// Structure to represent one message slot of the ring sink (a seqlock: odd while being written).
+// Every field is atomic and copied with relaxed accesses, so a reader that overlaps a writer
+// reads stale or torn words, which the sequence check then discards, but never races.
+struct LogSlot {
+    atomic<unsigned long long> sequence{ 0 };          // Bumped before and after each write
+    atomic<unsigned long long> index{ 0 };             // Position of the message in the output
+    atomic<size_t> length{ 0 };                        // Bytes of text
+    atomic<unsigned long long> text[LOG_SLOT_WORDS];   // Message text, packed into words (truncated if longer)
+};
+
+LogSink logSink = LOG_STDOUT;              // Where worker messages go
+FILE* logFile = nullptr;                   // Output file of the file sink
+LogSlot logRing[LOG_RING_SLOTS];           // Slots of the ring sink
+atomic<unsigned long long> logRingNext(0); // Messages written to the ring so far
+
+// Function to hand one composed message to the sink
+void emitLogMessage(const char* text, size_t length) {
+    if (logSink == LOG_RING) {
+        unsigned long long index = logRingNext.fetch_add(1, memory_order_relaxed);
+        LogSlot& slot = logRing[index % LOG_RING_SLOTS];
+        unsigned long long sequence = slot.sequence.load(memory_order_relaxed);
+        while ((sequence & 1) || !slot.sequence.compare_exchange_weak(sequence, sequence + 1, memory_order_acquire)) {
+            this_thread::yield(); // A writer a full lap behind still holds the slot
+            sequence = slot.sequence.load(memory_order_relaxed);
+        }
+        atomic_thread_fence(memory_order_release); // Readers that see the new text also see the odd sequence
+        size_t kept = min(length, LOG_SLOT_BYTES);
+        slot.index.store(index, memory_order_relaxed);
+        slot.length.store(kept, memory_order_relaxed);
+        for (size_t w = 0; w * sizeof(unsigned long long) < kept; ++w) {
+            unsigned long long word = 0;
+            memcpy(&word, text + w * sizeof(word), min(sizeof(word), kept - w * sizeof(word)));
+            slot.text[w].store(word, memory_order_relaxed);
+        }
+        slot.sequence.store(sequence + 2, memory_order_release);
+    }
+    else
+        fwrite(text, 1, length, logSink == LOG_FILE && logFile != nullptr ? logFile : stdout); // One locked stdio call
+}
+
+// Function to choose the sink: "stdout", "ring", or a file path. Returns false if the file cannot be opened.
+bool setLogSink(const string& target) {
+    if (target == "stdout")
+        logSink = LOG_STDOUT;
+    else if (target == "ring")
+        logSink = LOG_RING;
+    else {
+        logFile = fopen(target.c_str(), "w");
+        if (logFile == nullptr)
+            return false;
+        logSink = LOG_FILE;
+    }
+    return true;
+}
+
+// Function to copy the messages held by the ring sink, oldest first (messages still being
+// written are skipped)
+vector<string> logRingMessages() {
+    vector<pair<unsigned long long, string>> held;
+    for (LogSlot& slot : logRing) {
+        unsigned long long before = slot.sequence.load(memory_order_acquire);
+        if (before == 0 || (before & 1))
+            continue;
+        unsigned long long index = slot.index.load(memory_order_relaxed);
+        size_t length = min(slot.length.load(memory_order_relaxed), LOG_SLOT_BYTES);
+        string text(length, '\0');
+        for (size_t w = 0; w * sizeof(unsigned long long) < length; ++w) {
+            unsigned long long word = slot.text[w].load(memory_order_relaxed);
+            memcpy(&text[w * sizeof(word)], &word, min(sizeof(word), length - w * sizeof(word)));
+        }
+        atomic_thread_fence(memory_order_acquire); // Orders the copy before the re-check
+        if (slot.sequence.load(memory_order_relaxed) == before)
+            held.push_back({ index, move(text) });
+    }
+    sort(held.begin(), held.end());
+    vector<string> messages;
+    for (auto& entry : held)
+        messages.push_back(move(entry.second));
+    return messages;
+}
+
+// Class to compose one worker message; it is written out as a whole when the statement ends.
+// The thread's buffer keeps its capacity, so after warm-up composing a message does not allocate.
+// Each message owns the buffer from its own start offset, so a message composed while another is
+// still open on the same thread (a streamed value that logs) is emitted alone and leaves the
+// outer one intact.
+class LogLine {
+public:
+    LogLine() : text(threadBuffer()), start(text.size()) {}
+    ~LogLine() {
+        emitLogMessage(text.data() + start, text.size() - start);
+        text.resize(start);
+    }
+    LogLine(const LogLine&) = delete;
+    LogLine& operator=(const LogLine&) = delete;
+
+    LogLine& operator<<(const char* part) { text += part; return *this; }
+    LogLine& operator<<(const string& part) { text += part; return *this; }
+    LogLine& operator<<(char part) { text += part; return *this; }
+
+    template <typename Int, typename = enable_if_t<is_integral<Int>::value>>
+    LogLine& operator<<(Int value) {
+        char digits[24];
+        auto result = to_chars(digits, digits + sizeof(digits), value);
+        text.append(digits, result.ptr);
+        return *this;
+    }
+
+private:
+    static string& threadBuffer() {
+        thread_local string buffer;
+        return buffer;
+    }
+    string& text;        // The thread's buffer
+    size_t start;        // Where this message begins in it
+};
+
+// Inventory: each ingredient is one atomic counter. Reserving an order's ingredients takes each
+// counter down with a compare-and-swap that never goes below zero, and gives back what was taken
+// if any ingredient runs short, so order intake never waits on a lock.
+enum Ingredient { ING_DOUGH, ING_TOMATO, ING_CHEESE, ING_BEEF, ING_BUN, ING_POTATO, ING_PASTA, ING_GREENS, ING_DRESSING, ING_COUNT };
+const vector<string> ingredientNames = { "Dough", "Tomato", "Cheese", "Beef", "Bun", "Potato", "Pasta", "Greens", "Dressing" };
+int initialStock[ING_COUNT] = { 40, 120, 100, 40, 40, 50, 40, 50, 50 }; // Stock at the start of service
+atomic<int> stock[ING_COUNT];               // Portions of each ingredient on hand
+atomic<bool> lowStockRaised[ING_COUNT];     // Set when an ingredient drops below its low-stock level
+atomic<long long> lowStockEvents(0);        // Number of low-stock events raised
+atomic<long long> ordersOutOfStock(0);      // Orders refused because an ingredient ran out
+
+// Structure to represent a quantity of one ingredient
+struct Portion {
+    int ingredient;            // Ingredient used
+    int amount;                // Portions used (0 pads unused entries)
+};
+
+// Bill of materials: portions of each ingredient used by one serving of a menu item
+const int MAX_PORTIONS = 4;
+constexpr Portion billOfMaterials[ITEM_COUNT][MAX_PORTIONS] = {
+    { { ING_DOUGH, 1 }, { ING_TOMATO, 2 }, { ING_CHEESE, 2 } },                 // Pizza
+    { { ING_BUN, 1 }, { ING_BEEF, 1 }, { ING_CHEESE, 1 }, { ING_POTATO, 1 } },  // Burger
+    { { ING_PASTA, 1 }, { ING_TOMATO, 2 }, { ING_CHEESE, 1 } },                 // Pasta
+    { { ING_GREENS, 1 }, { ING_TOMATO, 1 }, { ING_DRESSING, 1 } },              // Salad
+};
+
+// Function to restock every ingredient to its initial level
+void resetInventory() {
+    for (int ing = 0; ing < ING_COUNT; ++ing) {
+        stock[ing] = initialStock[ing];
+        lowStockRaised[ing] = false;
+    }
+}
+
+// Function to get the low-stock level of an ingredient (a fifth of its initial stock)
+int lowStockLevel(int ingredient) {
+    return initialStock[ingredient] / 5;
+}
+
+// Function to total the ingredients needed by a list of food items
+void ingredientNeeds(const vector<MenuItem>& foods, int (&needs)[ING_COUNT]) {
+    fill(begin(needs), end(needs), 0);
+    for (MenuItem food : foods) {
+        for (const Portion& part : billOfMaterials[food])
+            needs[part.ingredient] += part.amount;
+    }
+}
+
+// Function to reserve ingredient amounts. Lock-free: each counter is taken down by a
+// compare-and-swap only while it holds enough, so stock is never negative and a concurrent order
+// that fits is never refused because of a reservation that is later undone. If any ingredient
+// runs short, everything taken so far is given back. Low-stock events are raised only once the
+// whole reservation has succeeded.
+bool reserveIngredientNeeds(const int (&needs)[ING_COUNT]) {
+    int before[ING_COUNT] = {};
+    for (int ing = 0; ing < ING_COUNT; ++ing) {
+        if (needs[ing] <= 0)
+            continue;
+        before[ing] = stock[ing].load(memory_order_relaxed);
+        do {
+            if (before[ing] < needs[ing]) {
+                for (int undo = 0; undo < ing; ++undo)
+                    if (needs[undo] > 0)
+                        stock[undo].fetch_add(needs[undo], memory_order_acq_rel);
+                ordersOutOfStock++;
+                return false;
+            }
+        } while (!stock[ing].compare_exchange_weak(before[ing], before[ing] - needs[ing], memory_order_acq_rel));
+    }
+    for (int ing = 0; ing < ING_COUNT; ++ing) {
+        int level = lowStockLevel(ing);
+        if (needs[ing] > 0 && before[ing] >= level && before[ing] - needs[ing] < level
+            && !lowStockRaised[ing].exchange(true))
+            lowStockEvents++;
+    }
+    return true;
+}
+
+// Function to reserve the ingredients for an order
+bool reserveIngredients(const vector<MenuItem>& foods) {
+    int needs[ING_COUNT];
+    ingredientNeeds(foods, needs);
+    return reserveIngredientNeeds(needs);
+}
+
+// Function to return reserved ingredient amounts
+void releaseIngredientNeeds(const int (&needs)[ING_COUNT]) {
+    for (int ing = 0; ing < ING_COUNT; ++ing) {
+        if (needs[ing] <= 0)
+            continue;
+        int after = stock[ing].fetch_add(needs[ing], memory_order_acq_rel) + needs[ing];
+        if (after >= lowStockLevel(ing))
+            lowStockRaised[ing] = false; // Back above the low-stock level: re-arm the event
+    }
+}
+
+// Function to return an order's reserved ingredients, e.g. when the order is cancelled
+void releaseIngredients(const vector<MenuItem>& foods) {
+    int needs[ING_COUNT];
+    ingredientNeeds(foods, needs);
+    releaseIngredientNeeds(needs);
+}
+
+// Function to check whether one more serving of a food item can be made right now
+bool canMake(MenuItem food) {
+    int needs[ING_COUNT];
+    ingredientNeeds({ food }, needs);
+    for (int ing = 0; ing < ING_COUNT; ++ing)
+        if (needs[ing] > stock[ing].load(memory_order_relaxed))
+            return false;
+    return true;
+}
+
+// Function to print the ingredients currently below their low-stock level
+void displayLowStock() {
+    for (int ing = 0; ing < ING_COUNT; ++ing) {
+        if (lowStockRaised[ing])
+            cout << "Low stock: " << ingredientNames[ing] << " (" << stock[ing] << " left)\n";
+    }
+}
+
+// Function to seed the order ID generator for this process and node
+void seedOrderIds(int node) {
+    const long long epochMs = 1704067200000LL; // 2024-01-01, keeps 41 bits of milliseconds for ~69 years
+    long long nowMs = chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count();
+    orderIdNode = node;
+    orderIdSequence = max(0LL, nowMs - epochMs) << 12;
+    orderIdGeneration++;
+}
+
+// Function to issue a new order ID
+OrderId nextOrderId() {
+    thread_local long long next = 0, end = 0;   // Remaining IDs of this thread's lease
+    thread_local int generation = -1;           // Generation the lease belongs to
+    if (next == end || generation != orderIdGeneration) {
+        generation = orderIdGeneration;
+        next = orderIdSequence.fetch_add(ORDER_ID_BLOCK);
+        end = next + ORDER_ID_BLOCK;
+    }
+    return (OrderId)(((uint64_t)orderIdNode << ORDER_ID_NODE_SHIFT) | (uint64_t)next++);
+}
+
+// Reservations: each table keeps its bookings in a map ordered by start time. Bookings on one
+// table never overlap, so a conflict check only looks at the neighbours of the insertion point
+// (O(log n)). As a booking approaches, its table is held: the allocator stops handing it to
+// walk-ins from reservationLeadMinutes before the start until the party checks in, or until
+// reservationGraceMinutes after the start, when an absent party counts as a no-show.
+// Lock order: reservationMutex may be taken while holding queueMutex, never the other way round.
+
+// Structure to represent one booking
+struct Reservation {
+    long long id;                               // Reservation number given to the guest
+    int table;                                  // Table booked
+    chrono::system_clock::time_point start;     // When the party arrives
+    chrono::system_clock::time_point end;       // When the table is free again
+    string guestName;                           // Name on the booking
+    bool seated = false;                        // Whether the party has checked in
+};
+
+vector<map<chrono::system_clock::time_point, Reservation>> reservationBook(5); // Bookings per table, by start
+InstrumentedMutex reservationMutex("reservationMutex"); // Mutex to protect the reservation book
+long long nextReservationId = 1;                       // Next reservation number (guarded by reservationMutex)
+int reservationLeadMinutes = 60;                       // How long before a booking its table is held
+int reservationGraceMinutes = 15;                      // How long after the start a held table waits for the party
+
+// Function to convert a time to local calendar time
+tm localCalendarTime(chrono::system_clock::time_point t) {
+    time_t seconds = chrono::system_clock::to_time_t(t);
+    tm calendar{};
+#ifdef _WIN32
+    localtime_s(&calendar, &seconds);
+#else
+    localtime_r(&seconds, &calendar);
+#endif
+    return calendar;
+}
+
+// Function to format a time as "YYYY-MM-DD HH:MM" in local time
+string formatLocalTime(chrono::system_clock::time_point t) {
+    tm calendar = localCalendarTime(t);
+    char text[32];
+    strftime(text, sizeof(text), "%Y-%m-%d %H:%M", &calendar);
+    return text;
+}
+
+// Function to parse "YYYY-MM-DD HH:MM" in local time; returns false if malformed
+bool parseLocalTime(const string& text, chrono::system_clock::time_point& t) {
+    tm calendar{};
+    istringstream in(text);
+    in >> get_time(&calendar, "%Y-%m-%d %H:%M");
+    if (in.fail())
+        return false;
+    calendar.tm_isdst = -1;
+    time_t seconds = mktime(&calendar);
+    if (seconds == (time_t)-1)
+        return false;
+    t = chrono::system_clock::from_time_t(seconds);
+    return true;
+}
+
+// Function to check whether [start, end) overlaps a booking on a table (reservationMutex held)
+bool reservationConflictLocked(int table, chrono::system_clock::time_point start, chrono::system_clock::time_point end) {
+    const auto& bookings = reservationBook[table - 1];
+    auto next = bookings.lower_bound(start);
+    if (next != bookings.end() && next->second.start < end)
+        return true;
+    return next != bookings.begin() && prev(next)->second.end > start;
+}
+
+// Function to book a table (reservationMutex held); returns the reservation number, or 0 on a conflict
+long long bookReservationLocked(int table, chrono::system_clock::time_point start, chrono::minutes length, const string& guestName) {
+    if (table < 1 || table > (int)reservationBook.size() || length.count() <= 0)
+        return 0;
+    auto end = start + length;
+    if (reservationConflictLocked(table, start, end))
+        return 0;
+    Reservation booking{ nextReservationId++, table, start, end, guestName };
+    reservationBook[table - 1].emplace(start, booking);
+    return booking.id;
+}
+
+// Function to book a table; returns the reservation number, or 0 if it conflicts with another booking
+long long bookReservation(int table, chrono::system_clock::time_point start, chrono::minutes length, const string& guestName) {
+    lock_guard<InstrumentedMutex> lock(reservationMutex);
+    return bookReservationLocked(table, start, length, guestName);
+}
+
+// Function to import bookings, one per line: "table,YYYY-MM-DD HH:MM,minutes,guest name".
+// Bookings are sorted per table first, so each insertion lands at the end of its table's map.
+void importReservations(istream& in) {
+    auto start = chrono::steady_clock::now();
+    vector<tuple<int, chrono::system_clock::time_point, int, string>> rows;
+    string line;
+    long long malformed = 0;
+    while (getline(in, line)) {
+        if (line.empty() || line[0] == '#')
+            continue;
+        stringstream fields(line);
+        string table, when, minutes, guest;
+        chrono::system_clock::time_point startTime;
+        if (!getline(fields, table, ',') || !getline(fields, when, ',') || !getline(fields, minutes, ',')
+            || !parseLocalTime(when, startTime)) {
+            malformed++;
+            continue;
+        }
+        getline(fields, guest);
+        try {
+            rows.emplace_back(stoi(table), startTime, stoi(minutes), guest);
+        }
+        catch (const exception&) {
+            malformed++;
+        }
+    }
+    sort(rows.begin(), rows.end(), [](const auto& a, const auto& b) {
+        return make_pair(get<0>(a), get<1>(a)) < make_pair(get<0>(b), get<1>(b));
+    });
+    long long booked = 0, conflicts = 0, noTable = 0;
+    {
+        lock_guard<InstrumentedMutex> lock(reservationMutex);
+        for (const auto& row : rows) {
+            if (get<0>(row) < 1 || get<0>(row) > (int)reservationBook.size())
+                noTable++;
+            else if (bookReservationLocked(get<0>(row), get<1>(row), chrono::minutes(get<2>(row)), get<3>(row)) != 0)
+                booked++;
+            else
+                conflicts++;
+        }
+    }
+    cout << "Imported " << booked << " reservations (" << conflicts << " conflicting or invalid, " << noTable
+        << " on tables that do not exist, " << malformed << " malformed lines) in " << chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count()
+        << " ms\n";
+}
+
+// Function to find the booking that holds a table at 'now', if any (reservationMutex held)
+const Reservation* heldReservationLocked(int table, chrono::system_clock::time_point now) {
+    if (table < 1 || table > (int)reservationBook.size())
+        return nullptr;
+    const auto& bookings = reservationBook[table - 1];
+    // Bookings that start within the lead time, latest first; stop once they have ended
+    auto it = bookings.upper_bound(now + chrono::minutes(reservationLeadMinutes));
+    while (it != bookings.begin()) {
+        --it;
+        if (it->second.end <= now)
+            break;
+        if (!it->second.seated && now < it->second.start + chrono::minutes(reservationGraceMinutes))
+            return &it->second; // Past the grace period the party is a no-show and the table is free
+    }
+    return nullptr;
+}
+
+// Function to check whether a table is held for an upcoming booking
+bool tableHeldForReservation(int table) {
+    lock_guard<InstrumentedMutex> lock(reservationMutex);
+    return heldReservationLocked(table, chrono::system_clock::now()) != nullptr;
+}
+
+// Function to find the first table marked free in 'available' that no booking holds (0 if none).
+// reservationMutex is taken once for the whole scan, not once per table.
+int firstUnheldTable(const vector<bool>& available) {
+    auto now = chrono::system_clock::now();
+    lock_guard<InstrumentedMutex> lock(reservationMutex);
+    for (size_t i = 0; i < available.size(); ++i)
+        if (available[i] && heldReservationLocked((int)i + 1, now) == nullptr)
+            return (int)i + 1;
+    return 0;
+}
+
+// Function to check a party in: if the booking holding 'table' now matches the reservation
+// number or the name on the booking, it is marked seated and the table is released to the party
+bool checkInReservation(int table, long long reservationId, const string& guestName) {
+    lock_guard<InstrumentedMutex> lock(reservationMutex);
+    const Reservation* held = heldReservationLocked(table, chrono::system_clock::now());
+    if (held == nullptr || (held->id != reservationId && (guestName.empty() || held->guestName != guestName)))
+        return false;
+    reservationBook[table - 1].at(held->start).seated = true;
+    return true;
+}
+
+// Load shedding: an admission controller in front of the queue, after CoDel. The signal is the
+// sojourn time, how long an order waited for a worker: a queue that empties now and then keeps
+// it low, while a standing queue keeps it above the target however fast the workers are. Once
+// the sojourn has stayed above the target for a whole interval the kitchen is overloaded, and
+// new orders are turned away until it drops below again. Every decision reads a few counters
+// kept up to date by the queue, so it costs the same at any queue length (see decideIntake).
+bool loadShedding = false;           // Whether new orders pass the admission controller (--shed)
+int shedTargetMs = 0;                // Target sojourn time (0 = four task durations, at least 5 ms)
+int shedIntervalMs = 0;              // Time above target before shedding (0 = five targets, at least 100 ms)
+int shedMaxWaitMs = 0;               // Longest wait quoted to a guest (0 = five targets)
+atomic<chrono::steady_clock::time_point> sojournAboveSince{}; // When the sojourn went above target (zero = below; written under queueMutex)
+atomic<bool> sheddingLoad(false);    // Whether orders are being turned away (written under queueMutex)
+long long sojournPeakMs = 0;         // Longest sojourn seen (guarded by queueMutex)
+long long sheddingEpisodes = 0;      // Times shedding started (guarded by queueMutex)
+
+// Outcomes of the admission controller: take the order, take it but quote a longer wait, or turn it away
+enum IntakeDecision { INTAKE_ACCEPT, INTAKE_QUOTE_LONGER, INTAKE_REJECT, INTAKE_DECISION_COUNT };
+atomic<long long> intakeDecisions[INTAKE_DECISION_COUNT] = {}; // Decisions made, by outcome
+
+// Function to get the target sojourn time
+chrono::milliseconds shedTarget() {
+    return chrono::milliseconds(shedTargetMs > 0 ? shedTargetMs : max(5, 4 * taskMillis));
+}
+
+// Function to get how long the sojourn must stay above target before orders are turned away
+chrono::milliseconds shedInterval() {
+    return shedIntervalMs > 0 ? chrono::milliseconds(shedIntervalMs) : max(chrono::milliseconds(100), 5 * shedTarget());
+}
+
+// Function to feed one sojourn time to the controller (queueMutex held): the time an order
+// dispatched now spent queued, or the age of the order at the head of the queue
+void noteSojournLocked(chrono::steady_clock::duration sojourn, chrono::steady_clock::time_point now) {
+    sojournPeakMs = max(sojournPeakMs, (long long)chrono::duration_cast<chrono::milliseconds>(sojourn).count());
+    if (sojourn < shedTarget()) {
+        sojournAboveSince = chrono::steady_clock::time_point();
+        sheddingLoad = false;
+    }
+    else if (sojournAboveSince.load().time_since_epoch().count() == 0)
+        sojournAboveSince = now;
+    else if (!sheddingLoad && now - sojournAboveSince.load() >= shedInterval()) {
+        sheddingLoad = true;
+        sheddingEpisodes++;
+    }
+}
+
+// Front-of-house snapshot: every change to tables, the queue or the waiting list is made under
+// queueMutex, and the writer then publishes it through a sequence lock. Publishing is O(1): the
+// counts are stored, and each table that changed is stored as it changes (see setTableLocked), so
+// the floor is never copied. Readers such as host-stand screens take no lock: they copy what they
+// need and retry if the sequence moved meanwhile, so they never stall the kitchen or each other.
+struct KitchenSnapshot {
+    unsigned long long version = 0;  // Increases by one with every published change
+    int queuedOrders = 0;            // Orders waiting for a worker
+    int queuedItems = 0;             // Items of the orders waiting for a worker
+    bool sheddingLoad = false;       // Whether the admission controller is turning orders away
+    int topQueuedPriority = -1;      // Highest class waiting for a worker (-1 if none)
+    int inFlightOrders = 0;          // Orders taken by workers but not yet finished
+    size_t completedOrders = 0;      // Orders finished so far
+    int waitingGuests = 0;           // Guests on the waiting list (its first entries, see waitingList)
+};
+
+// Structure to represent the published front-of-house state; written only under queueMutex.
+// Every access is sequentially consistent, which is what makes the sequence check sound without
+// fences: a reader that saw any store of a change also sees the sequence that change made odd.
+struct PublishedFrontOfHouse {
+    atomic<unsigned long long> sequence{ 0 };  // Odd while a change is being published
+    atomic<int> queuedOrders{ 0 }, queuedItems{ 0 }, topQueuedPriority{ -1 }, inFlightOrders{ 0 }, waitingGuests{ 0 };
+    atomic<bool> sheddingLoad{ false };
+    atomic<size_t> completedOrders{ 0 };
+    unique_ptr<atomic<bool>[]> tables;         // Table availability (true = available)
+    size_t tableCount = 0;                     // Sized with the kitchen, before any reader starts
+};
+
+PublishedFrontOfHouse frontOfHouse;
+
+// Function to open a published change, if one is not open yet (queueMutex held)
+void beginSnapshotChangeLocked() {
+    unsigned long long sequence = frontOfHouse.sequence.load();
+    if (sequence % 2 == 0)
+        frontOfHouse.sequence.store(sequence + 1);
+}
+
+// Function to mark a table available or taken (queueMutex held); published by the next publishSnapshotLocked
+void setTableLocked(size_t index, bool available) {
+    tables[index] = available;
+    beginSnapshotChangeLocked();
+    frontOfHouse.tables[index].store(available);
+}
+
+// Function to publish the current front-of-house state (queueMutex held)
+void publishSnapshotLocked() {
+    beginSnapshotChangeLocked();
+    if (frontOfHouse.tableCount != tables.size()) {
+        // The floor was resized (config load or explorer reset): no reader is running yet
+        frontOfHouse.tables.reset(new atomic<bool>[tables.size()]);
+        frontOfHouse.tableCount = tables.size();
+        for (size_t i = 0; i < tables.size(); ++i)
+            frontOfHouse.tables[i].store(tables[i]);
+    }
+    frontOfHouse.queuedOrders.store((int)orderQueue.size());
+    frontOfHouse.queuedItems.store(orderQueue.itemsFrom(PRIORITY_NORMAL));
+    frontOfHouse.sheddingLoad.store(sheddingLoad);
+    frontOfHouse.topQueuedPriority.store(orderQueue.topLane());
+    frontOfHouse.inFlightOrders.store(inFlightOrders);
+    frontOfHouse.completedOrders.store(completedOrders.size());
+    frontOfHouse.waitingGuests.store((int)waitingList.size());
+    frontOfHouse.sequence.store(frontOfHouse.sequence.load() + 1);
+}
+
+// Function to get a consistent view of the front of house without locking the kitchen; with
+// 'tableView', the table availability of the same version is copied too
+KitchenSnapshot kitchenSnapshot(vector<bool>* tableView = nullptr) {
+    KitchenSnapshot view;
+    while (true) {
+        unsigned long long sequence = frontOfHouse.sequence.load();
+        if (sequence % 2 == 1) {
+            this_thread::yield(); // A change is being published
+            continue;
+        }
+        view.queuedOrders = frontOfHouse.queuedOrders.load();
+        view.queuedItems = frontOfHouse.queuedItems.load();
+        view.sheddingLoad = frontOfHouse.sheddingLoad.load();
+        view.topQueuedPriority = frontOfHouse.topQueuedPriority.load();
+        view.inFlightOrders = frontOfHouse.inFlightOrders.load();
+        view.completedOrders = frontOfHouse.completedOrders.load();
+        view.waitingGuests = frontOfHouse.waitingGuests.load();
+        if (tableView != nullptr) {
+            tableView->resize(frontOfHouse.tableCount);
+            for (size_t i = 0; i < frontOfHouse.tableCount; ++i)
+                (*tableView)[i] = frontOfHouse.tables[i].load();
+        }
+        if (frontOfHouse.sequence.load() == sequence) {
+            view.version = sequence / 2;
+            return view;
+        }
+    }
+}
+
+// Function for pollers: fetches the current snapshot into 'view' and returns true if it is newer
+// than 'seenVersion', which is then advanced to it
+bool pollKitchenSnapshot(unsigned long long& seenVersion, KitchenSnapshot& view) {
+    view = kitchenSnapshot();
+    if (view.version == seenVersion)
+        return false;
+    seenVersion = view.version;
+    return true;
+}
+
+// Function to display the status of tables
+void displayAvailableTables() {
+    vector<bool> tableView;
+    kitchenSnapshot(&tableView);
+    cout << "\nTable Status:\n";
+    auto now = chrono::system_clock::now();
+    lock_guard<InstrumentedMutex> lock(reservationMutex);
+    for (size_t i = 0; i < tableView.size(); ++i) {
+        const Reservation* held = heldReservationLocked((int)i + 1, now);
+        cout << "Table " << i + 1 << ": " << (!tableView[i] ? "Unavailable"
+            : held != nullptr ? "Reserved from " + formatLocalTime(held->start) : "Available") << endl;
+    }
+    cout << endl;
+}
+
+// Function to display the food menu of a menu version
+void displayFoodMenu(const MenuVersion& version) {
+    cout << "Available Food Items:\n";
+    for (int i = 0; i < ITEM_COUNT; ++i) {
+        cout << i + 1 << ". " << version.names[i] << " " << formatCents(version.priceCents[i]);
+        if (!version.available[i])
+            cout << " (86'd)";
+        else if (!canMake(MenuItem(i)))
+            cout << " (Sold Out)";
+        else if (version.special[i])
+            cout << " (Special)";
+        cout << endl;
+    }
+}
+
+// Function to display the waiting list
+void displayWaitingList() {
+    auto view = kitchenSnapshot();
+    cout << "\nCurrent Waiting List (" << view.waitingGuests << "/" << waitingListCapacity << "):\n";
+    for (int i = 0; i < view.waitingGuests; ++i) {
+        cout << "- " << waitingList[i] << endl;
+    }
+    cout << "-----------------------------\n";
+}
+
+// CPU placement: threads can be pinned per role (worker task, line cooks, batcher). On NUMA
+// machines a shard can be confined to one node; memory is placed by first touch, so anything a
+// pinned shard allocates and fills lands on its own node.
+map<string, vector<int>> pinPlan;   // CPUs each thread role is pinned to; roles not listed float
+bool pinShardsToNodes = false;      // Whether each shard process is confined to one NUMA node
+
+// Function to parse a CPU list such as "0-3,8,10-11"
+vector<int> parseCpuList(const string& text) {
+    vector<int> cpus;
+    stringstream ss(text);
+    string part;
+    while (getline(ss, part, ',')) {
+        size_t dash = part.find('-');
+        try {
+            int first = stoi(part.substr(0, dash));
+            int last = dash == string::npos ? first : stoi(part.substr(dash + 1));
+            for (int cpu = first; cpu <= last; ++cpu)
+                cpus.push_back(cpu);
+        }
+        catch (const exception&) {
+            // Skip malformed entries
+        }
+    }
+    return cpus;
+}
+
+// Function to list the CPUs of each NUMA node (one node with every CPU where unknown)
+vector<vector<int>> numaNodes() {
+    vector<vector<int>> nodes;
+#ifdef __linux__
+    for (int node = 0;; ++node) {
+        ifstream in("/sys/devices/system/node/node" + to_string(node) + "/cpulist");
+        string list;
+        if (!in || !getline(in, list))
+            break;
+        nodes.push_back(parseCpuList(list));
+    }
+#endif
+    if (nodes.empty()) {
+        vector<int> all;
+        for (unsigned cpu = 0; cpu < max(1u, thread::hardware_concurrency()); ++cpu)
+            all.push_back((int)cpu);
+        nodes.push_back(all);
+    }
+    return nodes;
+}
+
+// Function to pin the calling thread to a set of CPUs; returns false if unsupported or refused
+bool pinCurrentThread(const vector<int>& cpus) {
+    if (cpus.empty())
+        return false;
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus)
+        if (cpu >= 0 && cpu < CPU_SETSIZE)
+            CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#elif defined(_WIN32)
+    DWORD_PTR mask = 0;
+    for (int cpu : cpus)
+        if (cpu >= 0 && cpu < (int)(8 * sizeof(DWORD_PTR)))
+            mask |= (DWORD_PTR)1 << cpu;
+    return SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#else
+    return false;
+#endif
+}
+
+// Function to pin the calling thread according to the pin plan for its role
+void applyPinning(const string& role) {
+    auto it = pinPlan.find(role);
+    if (it != pinPlan.end())
+        pinCurrentThread(it->second);
+}
+
+// Function to get the pin plan role of a worker task
+string taskRole(int task) {
+    static const char* roles[TASK_LIMIT] = { "none", "cook", "serve", "clean", "wash", "select" };
+    return task > 0 && task < TASK_LIMIT ? roles[task] : "none";
+}
+
+// Function to add a "--pin" entry: "role=cpus", or "auto" to give each role its own CPU in turn
+void addPinning(const string& spec) {
+    if (spec == "auto") {
+        const char* roles[] = { "cook", "serve", "clean", "wash", "select", "linecook", "batcher" };
+        vector<int> cpus;
+        for (const auto& node : numaNodes())
+            cpus.insert(cpus.end(), node.begin(), node.end());
+        for (size_t i = 0; i < sizeof(roles) / sizeof(roles[0]); ++i)
+            pinPlan[roles[i]] = { cpus[i % cpus.size()] };
+        return;
+    }
+    size_t eq = spec.find('=');
+    if (eq != string::npos)
+        pinPlan[spec.substr(0, eq)] = parseCpuList(spec.substr(eq + 1));
+}
+
+// Kitchen stations that recipe steps can require
+enum Station { STATION_PREP, STATION_STOVE, STATION_GRILL, STATION_OVEN, STATION_FRYER, STATION_PLATE, STATION_SINK, STATION_COUNT };
+const vector<string> stationNames = { "Prep", "Stove", "Grill", "Oven", "Fryer", "Plate", "Sink" };
+int stationCapacity[STATION_COUNT] = { 2, 2, 1, 1, 1, 1, 1 }; // Units of equipment per station
+
+// Structure to represent one timed step of a recipe
+struct RecipeStep {
+    const char* name;          // Name of the step
+    int station;               // Station the step runs on
+    int durationPct;           // Duration as a percentage of one task step (taskMillis)
+    unsigned depMask;          // Bit i set: step i must finish first (only earlier steps)
+};
+
+// Structure to represent the recipe of one menu item; steps are listed in dependency order
+const int MAX_RECIPE_STEPS = 5;
+struct Recipe {
+    int stepCount;                          // Number of steps used
+    RecipeStep steps[MAX_RECIPE_STEPS];     // The steps
+};
+
+// Recipes for each menu item, indexed by MenuItem
+constexpr Recipe recipes[ITEM_COUNT] = {
+    { 4, { { "Stretch dough", STATION_PREP, 40, 0 },               // Pizza
+           { "Add toppings", STATION_PREP, 30, 1u << 0 },
+           { "Bake", STATION_OVEN, 100, 1u << 1 },
+           { "Slice and plate", STATION_PLATE, 20, 1u << 2 } } },
+    { 5, { { "Toast bun", STATION_GRILL, 20, 0 },                  // Burger
+           { "Grill patty", STATION_GRILL, 80, 0 },
+           { "Fry chips", STATION_FRYER, 70, 0 },
+           { "Assemble", STATION_PREP, 30, 1u << 0 | 1u << 1 },
+           { "Plate", STATION_PLATE, 10, 1u << 2 | 1u << 3 } } },
+    { 3, { { "Boil pasta", STATION_STOVE, 80, 0 },                 // Pasta
+           { "Make sauce", STATION_STOVE, 60, 0 },
+           { "Toss and plate", STATION_PLATE, 20, 1u << 0 | 1u << 1 } } },
+    { 3, { { "Chop vegetables", STATION_PREP, 50, 0 },             // Salad
+           { "Dress", STATION_PREP, 20, 1u << 0 },
+           { "Plate", STATION_PLATE, 10, 1u << 1 } } },
+};
+
+// Compile-time check that every recipe only depends on earlier steps
+constexpr bool recipesWellFormed() {
+    for (int item = 0; item < ITEM_COUNT; ++item) {
+        if (recipes[item].stepCount < 1 || recipes[item].stepCount > MAX_RECIPE_STEPS)
+            return false;
+        for (int i = 0; i < recipes[item].stepCount; ++i)
+            if (recipes[item].steps[i].depMask >> i != 0)
+                return false;
+    }
+    return true;
+}
+static_assert(recipesWellFormed(), "recipe steps must be in dependency order");
+
+// Structure to represent one recipe step instance of an order being cooked
+struct DagNode {
+    MenuItem item;             // Food item the step belongs to
+    int position;              // Index of that item in the order
+    const char* stepName;      // Name of the step
+    const char* itemName;      // Name the item was sold under (owned by the job's menu version)
+    int station;               // Station the step runs on
+    int durationPct;           // Duration as a percentage of one task step
+    vector<int> successors;    // Nodes that depend on this one
+    int pendingDeps;           // Number of unfinished predecessors
+    int rank;                  // Critical path length from this node to the end of the order
+};
+
+// Structure to represent the recipe DAG of a whole order
+struct DagJob {
+    OrderId orderID;           // Order being cooked
+    OrderPriority priority;    // Class of the order: higher classes' steps run first
+    vector<DagNode> nodes;     // All steps of all items in the order
+    int remaining;             // Nodes not yet finished (guarded by dagMutex)
+    vector<int> stepsLeft;     // Steps not yet cooked, per item; skipped steps stay counted (guarded by dagMutex)
+    function<void()> onComplete; // Called by the line cook that finishes the last node, if set
+    shared_ptr<OrderHandle> handle; // Handle of the order: steps of a cancelled order are skipped
+    shared_ptr<const MenuVersion> menuVersion; // Menu the order was placed under (keeps item names alive)
+};
+
+// Structure to represent a step that is ready to run
+struct ReadyNode {
+    int rank;                  // Critical path priority of the step
+    long long sequence;        // Submission order, to break ties first-come first-served
+    shared_ptr<DagJob> job;    // Order the step belongs to
+    int node;                  // Index of the step in the order's DAG
+};
+
+// Ordering for the ready heap: highest priority class, then longest remaining critical path first
+struct CriticalPathFirst {
+    bool operator()(const ReadyNode& a, const ReadyNode& b) const {
+        if (a.job->priority != b.job->priority)
+            return a.job->priority < b.job->priority;
+        if (a.rank != b.rank)
+            return a.rank < b.rank;
+        return a.sequence > b.sequence;
+    }
+};
+
+priority_queue<ReadyNode, vector<ReadyNode>, CriticalPathFirst> readyNodes; // Steps ready to run on any line cook
+InstrumentedMutex dagMutex("dagMutex"); // Mutex to protect the ready heap and DAG bookkeeping
+condition_variable_any dagCv;  // Condition variable to notify line cooks and waiting workers
+vector<thread> lineCooks;      // Threads that execute recipe steps in parallel
+bool lineCooksStop = false;    // Flag to stop the line cooks (guarded by dagMutex)
+long long readySequence = 0;   // Counter for ready heap tie-breaking (guarded by dagMutex)
+int lineCookCount = 3;         // Number of line cook threads
+atomic<long long> dagMakespanMs(0); // Total wall time of all cooked orders
+atomic<long long> dagSerialMs(0);   // Total time the same orders would take cooked serially
+
+// Structure to represent a counting semaphore over one station's pool of equipment
+struct StationPool {
+    InstrumentedMutex poolMutex;      // Mutex to protect the free unit count, named after the station
+    condition_variable_any poolCv;    // Condition variable to notify waiting steps of a free unit
+    int available = 0;                // Free units of equipment
+    atomic<long long> busyMs{ 0 };    // Total time units were held
+    atomic<long long> acquisitions{ 0 }; // Number of times a unit was taken
+    atomic<long long> waits{ 0 };     // Number of acquisitions that had to wait
+
+    explicit StationPool(const char* lockName) : poolMutex(lockName) {}
+
+    void acquire() {
+        unique_lock<InstrumentedMutex> lock(poolMutex);
+        if (available == 0)
+            waits++;
+        poolCv.wait(lock, [this] { return available > 0; });
+        available--;
+        acquisitions++;
+    }
+
+    void release() {
+        {
+            lock_guard<InstrumentedMutex> lock(poolMutex);
+            available++;
+        }
+        poolCv.notify_one();
+    }
+};
+
+StationPool stationPools[STATION_COUNT] = {           // Equipment pools, one per station type
+    StationPool("prepPoolMutex"), StationPool("stovePoolMutex"), StationPool("grillPoolMutex"), StationPool("ovenPoolMutex"),
+    StationPool("fryerPoolMutex"), StationPool("platePoolMutex"), StationPool("sinkPoolMutex"),
+};
+chrono::steady_clock::time_point kitchenStartTime;     // When the kitchen was last started
+
+// Structure to represent the resources an admitted order may claim and currently holds
+struct BankerClaim {
+    int maxClaim[STATION_COUNT];      // Maximum units of each station the order may hold at once
+    int allocated[STATION_COUNT];     // Units of each station the order holds now
+};
+
+bool bankersEnabled = false;            // Whether orders pass Banker's-algorithm admission control
+map<OrderId, BankerClaim> bankerClaims;     // Claims of admitted orders, by order ID
+int bankerAvailable[STATION_COUNT];     // Units not allocated to any admitted order
+InstrumentedMutex bankerMutex("bankerMutex"); // Mutex to protect the Banker's state
+condition_variable_any bankerCv;        // Condition variable to notify waiting admissions and requests
+atomic<long long> admissionsTotal(0);   // Orders that passed admission control
+atomic<long long> admissionsDelayed(0); // Orders that had to wait to be admitted
+atomic<long long> admissionWaitMs(0);   // Total time orders waited for admission
+
+// Function to reset all station pools and the Banker's state to full capacity
+void resetStations() {
+    for (int st = 0; st < STATION_COUNT; ++st) {
+        lock_guard<InstrumentedMutex> lock(stationPools[st].poolMutex);
+        stationPools[st].available = stationCapacity[st];
+    }
+    lock_guard<InstrumentedMutex> lock(bankerMutex);
+    bankerClaims.clear();
+    for (int st = 0; st < STATION_COUNT; ++st)
+        bankerAvailable[st] = stationCapacity[st];
+}
+
+// Function to check whether every admitted order can still run to completion (Banker's safety check)
+bool isSafeState() {
+    int work[STATION_COUNT];
+    copy(begin(bankerAvailable), end(bankerAvailable), work);
+    vector<const BankerClaim*> pending;
+    for (const auto& entry : bankerClaims)
+        pending.push_back(&entry.second);
+    bool progress = true;
+    while (!pending.empty() && progress) {
+        progress = false;
+        for (size_t i = 0; i < pending.size(); ++i) {
+            bool canFinish = true;
+            for (int st = 0; st < STATION_COUNT && canFinish; ++st)
+                canFinish = pending[i]->maxClaim[st] - pending[i]->allocated[st] <= work[st];
+            if (canFinish) {
+                for (int st = 0; st < STATION_COUNT; ++st)
+                    work[st] += pending[i]->allocated[st];
+                pending.erase(pending.begin() + i);
+                progress = true;
+                break;
+            }
+        }
+    }
+    return pending.empty();
+}
+
+// Function to admit an order into the kitchen once its maximum claim keeps the state safe.
+// Returns false if a hard stop happened while waiting.
+bool admitOrder(OrderId orderID, const int (&maxClaim)[STATION_COUNT]) {
+    auto waitStart = chrono::steady_clock::now();
+    unique_lock<InstrumentedMutex> lock(bankerMutex);
+    BankerClaim claim;
+    copy(begin(maxClaim), end(maxClaim), claim.maxClaim);
+    fill(begin(claim.allocated), end(claim.allocated), 0);
+    bool delayed = false;
+    while (true) {
+        if (hardStopFlag)
+            return false;
+        bankerClaims[orderID] = claim;
+        if (isSafeState())
+            break;
+        bankerClaims.erase(orderID);
+        delayed = true;
+        bankerCv.wait(lock);
+    }
+    admissionsTotal++;
+    if (delayed) {
+        admissionsDelayed++;
+        admissionWaitMs += chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - waitStart).count();
+    }
+    return true;
+}
+
+// Function to grant one unit of a station to an admitted order once the grant keeps the state safe.
+// Returns false, granting nothing, if a hard stop happens or the order's claim has been retired.
+bool bankerRequest(OrderId orderID, int station) {
+    unique_lock<InstrumentedMutex> lock(bankerMutex);
+    while (true) {
+        auto it = bankerClaims.find(orderID);
+        if (hardStopFlag || it == bankerClaims.end())
+            return false;
+        BankerClaim& claim = it->second;
+        if (bankerAvailable[station] > 0 && claim.allocated[station] < claim.maxClaim[station]) {
+            bankerAvailable[station]--;
+            claim.allocated[station]++;
+            if (isSafeState())
+                return true;
+            bankerAvailable[station]++;
+            claim.allocated[station]--;
+        }
+        bankerCv.wait(lock);
+    }
+}
+
+// Function to return one unit of a station from an admitted order
+void bankerRelease(OrderId orderID, int station) {
+    {
+        lock_guard<InstrumentedMutex> lock(bankerMutex);
+        auto it = bankerClaims.find(orderID);
+        if (it == bankerClaims.end())
+            return; // Retired by a hard stop, which already gave back everything it held
+        bankerAvailable[station]++;
+        it->second.allocated[station]--;
+    }
+    bankerCv.notify_all();
+}
+
+// Function to remove a finished order's claim
+void retireOrder(OrderId orderID) {
+    {
+        lock_guard<InstrumentedMutex> lock(bankerMutex);
+        auto it = bankerClaims.find(orderID);
+        if (it == bankerClaims.end())
+            return;
+        for (int st = 0; st < STATION_COUNT; ++st)
+            bankerAvailable[st] += it->second.allocated[st];
+        bankerClaims.erase(it);
+    }
+    bankerCv.notify_all();
+}
+
+// Function to expand an order into the recipe DAG of all its items
+shared_ptr<DagJob> buildDagJob(const Order& order) {
+    auto job = make_shared<DagJob>();
+    job->orderID = order.orderID;
+    job->priority = effectivePriority(order);
+    job->handle = order.handle;
+    job->menuVersion = order.menuVersion;
+    for (MenuItem food : order.foods) {
+        const Recipe& recipe = recipes[food];
+        int base = (int)job->nodes.size();
+        int position = (int)job->stepsLeft.size();
+        job->stepsLeft.push_back(recipe.stepCount);
+        for (int i = 0; i < recipe.stepCount; ++i) {
+            const RecipeStep& step = recipe.steps[i];
+            DagNode node;
+            node.item = food;
+            node.position = position;
+            node.stepName = step.name;
+            node.itemName = soldItemName(order, food);
+            node.station = step.station;
+            node.durationPct = step.durationPct * (order.menuVersion ? order.menuVersion->prepTimePct[food] : baseMenu.prepTimePct[food]) / 100;
+            node.pendingDeps = 0;
+            node.rank = 0;
+            for (int dep = 0; dep < i; ++dep) {
+                if (step.depMask & (1u << dep)) {
+                    node.pendingDeps++;
+                    job->nodes[base + dep].successors.push_back(base + i);
+                }
+            }
+            job->nodes.push_back(node);
+        }
+    }
+    // Steps are in dependency order, so a reverse pass computes each node's critical path
+    for (int i = (int)job->nodes.size() - 1; i >= 0; --i) {
+        int longestSuccessor = 0;
+        for (int next : job->nodes[i].successors)
+            longestSuccessor = max(longestSuccessor, job->nodes[next].rank);
+        job->nodes[i].rank = job->nodes[i].durationPct + longestSuccessor;
+    }
+    job->remaining = (int)job->nodes.size();
+    return job;
+}
+
+// Function executed by each line cook thread: runs ready steps, highest critical path first
+void lineCookFunction(int cookNumber) {
+    setTraceThreadName("Line cook " + to_string(cookNumber));
+    applyPinning("linecook");
+    unique_lock<InstrumentedMutex> lock(dagMutex);
+    while (true) {
+        dagCv.wait(lock, [] { return !readyNodes.empty() || lineCooksStop; });
+        if (lineCooksStop)
+            break;
+        ReadyNode ready = readyNodes.top();
+        readyNodes.pop();
+        lock.unlock();
+
+        // Take a unit of the step's station for the duration of the step. Steps of a cancelled
+        // order are only retired, so the job drains at once.
+        const DagNode& node = ready.job->nodes[ready.node];
+        bool cooked = !ready.job->handle || ready.job->handle->state.load(memory_order_acquire) != ORDER_CANCELLED;
+        if (cooked) {
+            TraceSpan stepSpan(node.stepName, "recipe", ready.job->orderID, 0, node.itemName);
+            if (bankersEnabled && !bankerRequest(ready.job->orderID, node.station))
+                cooked = false; // Hard stop: the step is skipped like a cancelled one
+            else {
+                StationPool& pool = stationPools[node.station];
+                pool.acquire();
+                auto stepStart = chrono::steady_clock::now();
+                this_thread::sleep_for(chrono::milliseconds(taskMillis * node.durationPct / 100)); // Simulate the step
+                pool.busyMs += chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - stepStart).count();
+                pool.release();
+                if (bankersEnabled)
+                    bankerRelease(ready.job->orderID, node.station);
+            }
+        }
+
+        lock.lock();
+        if (cooked)
+            ready.job->stepsLeft[node.position]--;
+        for (int next : node.successors) {
+            if (--ready.job->nodes[next].pendingDeps == 0)
+                readyNodes.push({ ready.job->nodes[next].rank, readySequence++, ready.job, next });
+        }
+        if (--ready.job->remaining == 0 && ready.job->onComplete) {
+            lock.unlock();
+            ready.job->onComplete();
+            lock.lock();
+        }
+        dagCv.notify_all();
+    }
+}
+
+// Function to start the line cook threads
+void startLineCooks() {
+    lock_guard<InstrumentedMutex> lock(dagMutex);
+    lineCooksStop = false;
+    for (int i = 0; i < lineCookCount; ++i)
+        lineCooks.emplace_back(lineCookFunction, i + 1);
+}
+
+// Function to stop the line cook threads, dropping any steps not yet started
+void stopLineCooks() {
+    {
+        lock_guard<InstrumentedMutex> lock(dagMutex);
+        lineCooksStop = true;
+        readyNodes = {};
+    }
+    dagCv.notify_all();
+    for (auto& cook : lineCooks)
+        cook.join();
+    lineCooks.clear();
+}
+
+// Function to admit a DAG job through Banker's admission control, if enabled.
+// The job can hold at most one unit per step on a station, up to the station's capacity.
+bool admitDagJob(const DagJob& job) {
+    if (!bankersEnabled)
+        return true;
+    int maxClaim[STATION_COUNT] = {};
+    for (const auto& node : job.nodes)
+        maxClaim[node.station] = min(maxClaim[node.station] + 1, stationCapacity[node.station]);
+    return admitOrder(job.orderID, maxClaim);
+}
+
+// Function to make a job's root steps ready (dagMutex held); returns the job's serial time in percent
+int pushJobRootsLocked(const shared_ptr<DagJob>& job) {
+    int serialPct = 0;
+    for (size_t i = 0; i < job->nodes.size(); ++i) {
+        serialPct += job->nodes[i].durationPct;
+        if (job->nodes[i].pendingDeps == 0)
+            readyNodes.push({ job->nodes[i].rank, readySequence++, job, (int)i });
+    }
+    dagCv.notify_all();
+    return serialPct;
+}
+
+// Function to cook a whole order on the line cooks; returns false if a hard stop interrupted it.
+// If itemsCooked is given it receives, per item, whether every step of it was cooked (steps of
+// an order cancelled meanwhile are skipped).
+bool cookOrderDag(const Order& order, chrono::milliseconds& makespan, vector<bool>* itemsCooked = nullptr) {
+    auto job = buildDagJob(order);
+    auto start = chrono::steady_clock::now();
+    int serialPct = 0;
+    bool finished = false;
+    if (!admitDagJob(*job))
+        return false;
+    {
+        unique_lock<InstrumentedMutex> lock(dagMutex);
+        serialPct = pushJobRootsLocked(job);
+        dagCv.wait(lock, [&job] { return job->remaining == 0 || hardStopFlag; });
+        finished = job->remaining == 0;
+        if (itemsCooked != nullptr) {
+            itemsCooked->clear();
+            for (int left : job->stepsLeft)
+                itemsCooked->push_back(left == 0);
+        }
+    }
+    if (bankersEnabled)
+        retireOrder(job->orderID);
+    if (!finished)
+        return false;
+    makespan = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start);
+    dagMakespanMs += makespan.count();
+    dagSerialMs += (long long)taskMillis * serialPct / 100;
+    return true;
+}
+
+// Analytics: each completion is folded into running aggregates as it happens, so no report ever
+// rescans completedOrders. Every recording thread owns a shard of counters that only it writes;
+// reports merge the shards on read. Windowed figures come from a ring of per-minute buckets
+// covering the last day, which serves both sliding (last N minutes) and tumbling (current
+// quarter-hour, hour, day) windows.
+int analyticsWorkerSlots = 64;             // Worker IDs tracked (higher IDs share the last slot; see sizeKitchen)
+int analyticsTableSlots = 64;              // Tables tracked (higher numbers share the last slot; see sizeKitchen)
+const int ANALYTICS_BUCKETS = 24 * 60;     // One bucket per minute for a day
+
+// Structure to represent one minute of completions in a shard
+struct AnalyticsBucket {
+    atomic<long long> minute{ -1 };        // Minute (since the Unix epoch) the bucket holds
+    atomic<long long> orders{ 0 };         // Orders completed in that minute
+    atomic<long long> items{ 0 };          // Items in those orders
+    atomic<long long> revenueCents{ 0 };   // Menu value of those orders
+};
+
+// Structure to represent the running aggregates recorded by one thread
+struct AnalyticsShard {
+    atomic<long long> orders{ 0 };                              // Orders completed
+    atomic<long long> revenueCents{ 0 };                        // Menu value of those orders
+    atomic<long long> itemCounts[ITEM_COUNT] = {};              // Items completed, per menu item
+    int namedVersion[ITEM_COUNT];                               // Menu version whose names reached analyticsItemNames
+
+    unique_ptr<atomic<long long>[]> workerOrders{ new atomic<long long>[analyticsWorkerSlots]() }; // Orders completed, per worker
+    unique_ptr<atomic<long long>[]> tableTurns{ new atomic<long long>[analyticsTableSlots]() };    // Orders served, per table
+    AnalyticsBucket buckets[ANALYTICS_BUCKETS];                 // Per-minute ring for the windows
+
+    AnalyticsShard() { fill(begin(namedVersion), end(namedVersion), -2); }
+};
+
+// Structure to represent the totals of one window
+struct AnalyticsWindow {
+    long long orders = 0;                  // Orders completed in the window
+    long long items = 0;                   // Items in those orders
+    long long revenueCents = 0;            // Menu value of those orders
+};
+
+vector<unique_ptr<AnalyticsShard>> analyticsShards; // All registered per-thread shards
+InstrumentedMutex analyticsRegistryMutex("analyticsRegistryMutex"); // Leaf lock for shard registration and merging
+SoldItemNames analyticsItemNames;                    // Names completed items were sold under (guarded by analyticsRegistryMutex)
+thread_local AnalyticsShard* localAnalyticsShard = nullptr; // This thread's shard
+
+// Function to add to a counter that only the calling thread writes
+void bumpCounter(atomic<long long>& counter, long long amount) {
+    counter.store(counter.load(memory_order_relaxed) + amount, memory_order_relaxed);
+}
+
+// Function to get the current minute since the Unix epoch
+long long analyticsMinute() {
+    return chrono::duration_cast<chrono::minutes>(chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Function to fold one completed order into the calling thread's shard: O(1) per order
+void recordCompletion(const Order& order) {
+    if (localAnalyticsShard == nullptr) {
+        auto shard = make_unique<AnalyticsShard>();
+        lock_guard<InstrumentedMutex> lock(analyticsRegistryMutex);
+        localAnalyticsShard = shard.get();
+        analyticsShards.push_back(move(shard));
+    }
+    AnalyticsShard& shard = *localAnalyticsShard;
+    long long revenue = orderRevenueCents(order);
+    int version = menuVersionNumber(order);
+    bool newVersion = false;
+    for (MenuItem food : order.foods) {
+        bumpCounter(shard.itemCounts[food], 1);
+        newVersion = newVersion || shard.namedVersion[food] != version;
+        shard.namedVersion[food] = version;
+    }
+    if (newVersion) { // Names are only looked at once per thread and menu version
+        lock_guard<InstrumentedMutex> lock(analyticsRegistryMutex);
+        analyticsItemNames.add(order);
+    }
+    bumpCounter(shard.orders, 1);
+    bumpCounter(shard.revenueCents, revenue);
+    bumpCounter(shard.workerOrders[min(max(order.workerID, 0), analyticsWorkerSlots - 1)], 1);
+    if (order.table > 0)
+        bumpCounter(shard.tableTurns[min(order.table, analyticsTableSlots) - 1], 1);
+
+    long long minute = analyticsMinute();
+    AnalyticsBucket& bucket = shard.buckets[minute % ANALYTICS_BUCKETS];
+    if (bucket.minute.load(memory_order_relaxed) != minute) {
+        // The bucket last held a minute that has left the day-long ring: start it over
+        bucket.orders.store(0, memory_order_relaxed);
+        bucket.items.store(0, memory_order_relaxed);
+        bucket.revenueCents.store(0, memory_order_relaxed);
+        bucket.minute.store(minute, memory_order_release);
+    }
+    bumpCounter(bucket.orders, 1);
+    bumpCounter(bucket.items, (long long)order.foods.size());
+    bumpCounter(bucket.revenueCents, revenue);
+}
+
+// Function to merge the shards' buckets for the minutes in [fromMinute, toMinute]
+AnalyticsWindow analyticsWindow(long long fromMinute, long long toMinute) {
+    AnalyticsWindow window;
+    fromMinute = max(fromMinute, toMinute - ANALYTICS_BUCKETS + 1);
+    lock_guard<InstrumentedMutex> lock(analyticsRegistryMutex);
+    for (const auto& shard : analyticsShards) {
+        for (long long minute = fromMinute; minute <= toMinute; ++minute) {
+            const AnalyticsBucket& bucket = shard->buckets[minute % ANALYTICS_BUCKETS];
+            if (bucket.minute.load(memory_order_acquire) != minute)
+                continue;
+            window.orders += bucket.orders.load(memory_order_relaxed);
+            window.items += bucket.items.load(memory_order_relaxed);
+            window.revenueCents += bucket.revenueCents.load(memory_order_relaxed);
+        }
+    }
+    return window;
+}
+
+// Function to format the totals of one window
+string formatWindow(const AnalyticsWindow& window) {
+    return to_string(window.orders) + " orders, " + to_string(window.items) + " items, "
+        + formatCents(window.revenueCents);
+}
+
+// Function to print the running aggregates and the sliding and tumbling windows
+void printAnalyticsReport() {
+    long long orders = 0, revenue = 0;
+    long long itemCounts[ITEM_COUNT] = {};
+    vector<long long> workerOrders(analyticsWorkerSlots), tableTurns(analyticsTableSlots);
+    vector<string> itemLabels;
+    {
+        lock_guard<InstrumentedMutex> lock(analyticsRegistryMutex);
+        itemLabels = analyticsItemNames.labels();
+        for (const auto& shard : analyticsShards) {
+            orders += shard->orders.load(memory_order_relaxed);
+            revenue += shard->revenueCents.load(memory_order_relaxed);
+            for (int i = 0; i < ITEM_COUNT; ++i)
+                itemCounts[i] += shard->itemCounts[i].load(memory_order_relaxed);
+            for (int w = 0; w < analyticsWorkerSlots; ++w)
+                workerOrders[w] += shard->workerOrders[w].load(memory_order_relaxed);
+            for (int t = 0; t < analyticsTableSlots; ++t)
+                tableTurns[t] += shard->tableTurns[t].load(memory_order_relaxed);
+        }
+    }
+    if (orders == 0)
+        return;
+
+    long long now = analyticsMinute();
+    cout << "Analytics: " << orders << " orders, " << formatCents(revenue) << " revenue\n";
+    cout << "  Last 15 min: " << formatWindow(analyticsWindow(now - 14, now))
+        << " | last hour: " << formatWindow(analyticsWindow(now - 59, now))
+        << " | last day: " << formatWindow(analyticsWindow(now - ANALYTICS_BUCKETS + 1, now)) << "\n";
+    cout << "  This quarter-hour: " << formatWindow(analyticsWindow(now - now % 15, now))
+        << " | this hour: " << formatWindow(analyticsWindow(now - now % 60, now))
+        << " | today (UTC): " << formatWindow(analyticsWindow(now - now % ANALYTICS_BUCKETS, now)) << "\n";
+    cout << "  Items:";
+    for (int i = 0; i < ITEM_COUNT; ++i)
+        if (itemCounts[i] > 0)
+            cout << " " << itemLabels[i] << " " << itemCounts[i];
+    // A per-minute rate is only shown once the kitchen has run for a full minute; over a shorter
+    // run it would extrapolate a few orders into a meaningless rate
+    double runMinutes = (double)chrono::duration_cast<chrono::milliseconds>(
+        chrono::steady_clock::now() - kitchenStartTime).count() / 60000.0;
+    bool showRate = runMinutes >= 1.0;
+    bool workerOverflow = any_of(workerCredentials.begin(), workerCredentials.end(),
+        [](const WorkerCredential& wc) { return wc.workerId >= analyticsWorkerSlots; });
+    cout << (showRate ? "\n  Workers (orders, per minute):" : "\n  Workers (orders):");
+    for (int w = 0; w < analyticsWorkerSlots; ++w) {
+        if (workerOrders[w] == 0)
+            continue;
+        cout << " #" << w << (w == analyticsWorkerSlots - 1 && workerOverflow ? "+" : "") << " " << workerOrders[w];
+        if (showRate)
+            cout << " (" << (long long)(workerOrders[w] / runMinutes) << "/min)";
+    }
+    cout << "\n  Table turnover:";
+    for (int t = 0; t < analyticsTableSlots; ++t)
+        if (tableTurns[t] > 0)
+            cout << " T" << t + 1 << (t == analyticsTableSlots - 1 && (int)tables.size() > analyticsTableSlots ? "+" : "")
+                << " " << tableTurns[t];
+    cout << "\n";
+}
+
+// Core kitchen operations. Each one is a single critical section whose caller holds queueMutex;
+// the worker loop, guest intake and the schedule explorer are all built from them.
+
+// Function to attach a cancel/modify handle to an order before it is submitted
+shared_ptr<OrderHandle> trackOrder(Order& order, bool holdsIngredients) {
+    auto handle = make_shared<OrderHandle>();
+    handle->orderID = order.orderID;
+    handle->holdsIngredients = holdsIngredients;
+    handle->foods = order.foods;
+    order.handle = handle;
+    order.holdsIngredients = holdsIngredients;
+    return handle;
+}
+
+// Function to cancel an order. A queued order is dropped when a worker dequeues it, and one in
+// progress stops at its next item boundary. Returns false if it already completed or was cancelled.
+bool cancelOrder(OrderHandle& handle) {
+    int state = handle.state.load(memory_order_acquire);
+    while (true) {
+        if (state == ORDER_COMPLETED || state == ORDER_CANCELLED)
+            return false;
+        if (state == ORDER_MODIFYING) {
+            this_thread::yield();
+            state = handle.state.load(memory_order_acquire);
+            continue;
+        }
+        if (handle.state.compare_exchange_weak(state, ORDER_CANCELLED, memory_order_acq_rel))
+            return true;
+    }
+}
+
+// Function to change the items of an order that is still queued. Only the difference between
+// the new and old items is reserved (and what is no longer needed given back), so a change that
+// needs no more stock always fits. The queued lane's item count is corrected at once, so queue
+// depth, wait quotes and admission see the new items. queueMutex is taken before the CAS, so a
+// worker holding it never waits on this change. Returns false once a worker has taken the order.
+bool modifyOrder(OrderHandle& handle, const vector<MenuItem>& foods) {
+    lock_guard<InstrumentedMutex> lock(queueMutex);
+    int expected = ORDER_QUEUED;
+    if (!handle.state.compare_exchange_strong(expected, ORDER_MODIFYING, memory_order_acq_rel))
+        return false;
+    if (handle.holdsIngredients) {
+        int more[ING_COUNT], fewer[ING_COUNT];
+        ingredientNeeds(foods, more);
+        ingredientNeeds(handle.foods, fewer);
+        for (int ing = 0; ing < ING_COUNT; ++ing) {
+            int change = more[ing] - fewer[ing];
+            more[ing] = max(change, 0);
+            fewer[ing] = max(-change, 0);
+        }
+        if (!reserveIngredientNeeds(more)) {
+            handle.state.store(ORDER_QUEUED, memory_order_release);
+            return false;
+        }
+        releaseIngredientNeeds(fewer);
+    }
+    if (handle.queuedLane >= 0)
+        orderQueue.adjustItems(handle.queuedLane, (int)foods.size() - (int)handle.foods.size());
+    handle.foods = foods;
+    handle.revised = true;
+    handle.state.store(ORDER_QUEUED, memory_order_release);
+    publishSnapshotLocked();
+    ordersModified++;
+    return true;
+}
+
+// Function to retire a cancelled order (queueMutex held): frees its table and gives back the
+// ingredients of the items not made yet (order.itemsDone onwards)
+void dropCancelledOrderLocked(const Order& order, bool inFlight) {
+    const OrderHandle& handle = *order.handle;
+    const vector<MenuItem>& foods = inFlight ? order.foods : handle.foods; // A worker's copy may be reordered
+    if (handle.holdsIngredients && order.itemsDone < foods.size())
+        releaseIngredients(vector<MenuItem>(foods.begin() + order.itemsDone, foods.end()));
+    if (order.table >= 1 && order.table <= (int)tables.size()) {
+        setTableLocked(order.table - 1, true);
+        tableBoost[order.table - 1] = PRIORITY_NORMAL;
+    }
+    if (inFlight) {
+        inFlightOrders--;
+        cancelledInProgress++;
+    }
+    else
+        cancelledQueued++;
+    publishSnapshotLocked();
+    drainCv.notify_all();
+}
+
+// Function to take the next order off the queue (queueMutex held); returns false if it is empty.
+// Cancelled orders met on the way are dropped here rather than searched for when cancelled.
+bool popOrderLocked(Order& order) {
+    while (!orderQueue.empty()) {
+        order = orderQueue.front();
+        orderQueue.pop();
+        if (claimOrder(order)) {
+            inFlightOrders++;
+            if (order.itemsDone == 0) { // A resumed slice has already been dispatched once
+                auto now = chrono::steady_clock::now();
+                noteSojournLocked(now - order.arrivalTime, now);
+            }
+            publishSnapshotLocked();
+            return true;
+        }
+        dropCancelledOrderLocked(order, false);
+    }
+    return false;
+}
+
+// Function to give an order the first free table (queueMutex held).
+// If every table is taken the order goes back on the queue and false is returned.
+// While closing, an order that only reservations keep from a table is dropped instead.
+bool assignTableLocked(Order& order) {
+    if (int table = firstUnheldTable(tables)) {
+        order.table = table;
+        setTableLocked(table - 1, false); // Mark the table as unavailable
+        publishSnapshotLocked();
+        return true;
+    }
+    // Closing, and no table is occupied: only bookings keep the order from a table, and they will
+    // not end before the drain would. The order is dropped so the drain can finish.
+    if (!intakeOpen && all_of(tables.begin(), tables.end(), [](bool available) { return available; })) {
+        if (order.handle)
+            cancelOrder(*order.handle); // If the guest cancelled first, the order is dropped all the same
+        if (order.holdsIngredients && order.itemsDone < order.foods.size())
+            releaseIngredients(vector<MenuItem>(order.foods.begin() + order.itemsDone, order.foods.end()));
+        ordersUnseated++;
+        inFlightOrders--;
+        publishSnapshotLocked();
+        drainCv.notify_all();
+        if (consoleLogging)
+            LogLine() << "\nOrder " << order.orderID << " dropped: every free table is held for a booking\n";
+        return false;
+    }
+    // No table: every holder inherits this order's class, so the orders keeping it waiting
+    // are neither passed over in the queue nor preempted by anything below it
+    OrderPriority priority = effectivePriority(order);
+    if (priority > PRIORITY_NORMAL) {
+        bool raised = false;
+        for (size_t i = 0; i < tables.size() && i < tableBoost.size(); ++i) {
+            if (!tables[i] && tableBoost[i] < priority) {
+                tableBoost[i] = priority;
+                raised = true;
+            }
+        }
+        raised = orderQueue.raiseTableHolders(priority) > 0 || raised;
+        if (raised)
+            priorityBoosts++;
+    }
+    if (order.handle && order.itemsDone == 0) {
+        int expected = ORDER_IN_PROGRESS; // Not started: the guest may still change it
+        order.handle->state.compare_exchange_strong(expected, ORDER_QUEUED, memory_order_acq_rel);
+    }
+    orderQueue.push(order);
+    inFlightOrders--;
+    publishSnapshotLocked();
+    cv.notify_one();
+    return false;
+}
+
+// Function for a guest to give back a table claimed for an order that was not placed (queueMutex held)
+void releaseTableLocked(int table) {
+    setTableLocked(table - 1, true);
+    publishSnapshotLocked();
+}
+
+// Function for a guest to claim a specific table (queueMutex held); returns false if it is taken
+// A table held for an upcoming booking can only be claimed once the party has checked in.
+bool claimTableLocked(int table) {
+    if (table < 1 || table > (int)tables.size() || !tables[table - 1] || tableHeldForReservation(table))
+        return false;
+    setTableLocked(table - 1, false);
+    publishSnapshotLocked();
+    return true;
+}
+
+// Function to record a finished order and release its table (queueMutex held)
+void finishOrderLocked(const Order& order) {
+    classCompleted[order.priority]++;
+    if (order.arrivalTime.time_since_epoch().count() != 0)
+        classLatencyMs[order.priority] += chrono::duration_cast<chrono::milliseconds>(
+            chrono::steady_clock::now() - order.arrivalTime).count();
+    if (order.deadline.time_since_epoch().count() != 0) {
+        auto now = chrono::steady_clock::now();
+        if (now <= order.deadline)
+            ordersOnTime++;
+        else {
+            deadlineMisses++;
+            totalLatenessMs += chrono::duration_cast<chrono::milliseconds>(now - order.deadline).count();
+        }
+    }
+    completedOrders.push_back(order);
+    completedOrders.back().completedTime = chrono::steady_clock::now();
+    if (order.table >= 1 && order.table <= (int)tables.size()) {
+        setTableLocked(order.table - 1, true);
+        tableBoost[order.table - 1] = PRIORITY_NORMAL;
+    }
+    inFlightOrders--;
+    publishSnapshotLocked();
+    drainCv.notify_all();
+}
+
+// Function to check whether a queued order could start right away: it already has a table, or
+// one is free (queueMutex held). Yielding to an order that would just wait for a table only adds delay.
+bool canStartNowLocked(const Order& next) {
+    return next.table != 0 || firstUnheldTable(tables) != 0;
+}
+
+// Function to get the class a running order holds, including any boost on its table (queueMutex held)
+OrderPriority runningPriorityLocked(const Order& current) {
+    OrderPriority mine = effectivePriority(current);
+    if (current.table >= 1 && current.table <= (int)tableBoost.size())
+        mine = max(mine, tableBoost[current.table - 1]);
+    return mine;
+}
+
+// Function to check whether a worker should set its order aside for a queued one (queueMutex held).
+// Only an order of a higher class that can start right away preempts.
+bool shouldPreemptLocked(const Order& current) {
+    if (orderQueue.empty())
+        return false;
+    const Order& next = orderQueue.front();
+    return effectivePriority(next) > runningPriorityLocked(current) && canStartNowLocked(next);
+}
+
+// Function to check whether an order whose round-robin quantum ran out should be handed back
+// (queueMutex held): only if an order of the same or a higher class is waiting and can start
+bool shouldYieldSliceLocked(const Order& current) {
+    if (orderQueue.empty())
+        return false;
+    const Order& next = orderQueue.front();
+    return effectivePriority(next) >= runningPriorityLocked(current) && canStartNowLocked(next);
+}
+
+// Function to check whether the round-robin quantum of a slice is used up
+bool sliceExpired(size_t itemsInSlice, chrono::steady_clock::time_point sliceStart) {
+    if (sliceQuantumItems > 0 && (int)itemsInSlice >= sliceQuantumItems)
+        return true;
+    return sliceQuantumMillis > 0
+        && chrono::steady_clock::now() - sliceStart >= chrono::milliseconds(sliceQuantumMillis);
+}
+
+// Function to get the round-robin quantum in items for cooks, who cook a slice as one recipe DAG
+// (0 = the whole order)
+size_t cookSliceItems() {
+    if (sliceQuantumItems > 0)
+        return (size_t)sliceQuantumItems;
+    if (sliceQuantumMillis > 0)
+        return (size_t)max(1, sliceQuantumMillis / max(1, taskMillis));
+    return 0;
+}
+
+// Function to checkpoint a partly processed order back into the queue (queueMutex held).
+// The order keeps its table and resumes at order.itemsDone; if a higher class is waiting for
+// that table, the order goes back in at that class.
+void checkpointOrderLocked(Order& order) {
+    if (order.table >= 1 && order.table <= (int)tableBoost.size())
+        order.inheritedPriority = max(order.inheritedPriority, tableBoost[order.table - 1]);
+    orderQueue.push(order);
+    inFlightOrders--;
+    publishSnapshotLocked();
+    cv.notify_one();
+}
+
+// Batching stage: cooks park their orders here, and identical items from different orders are
+// coalesced into one cook pass of up to batchLimit(item) items. A bucket is dispatched when it is
+// full, when its oldest item has waited batchMaxWaitMillis, or at once when it holds a rush, VIP
+// or refire item, so those never wait out a batch window. When a pass finishes, each item is
+// credited back to its order, and the order completes once all of its items are cooked.
+
+// Structure to represent an order parked while its items are batch cooked
+struct ParkedOrder {
+    Order order;               // The order, already seated and assigned to a cook
+    int itemsLeft;             // Items not yet cooked (guarded by batchMutex)
+};
+
+// Structure to represent one item waiting in a batch bucket
+struct PendingItem {
+    shared_ptr<ParkedOrder> owner;                 // Order the item belongs to
+    chrono::steady_clock::time_point queuedAt;     // When the item entered the bucket
+};
+
+bool batchingEnabled = false;          // Whether cooks park orders in the batching stage
+int batchSizeLimit = 1;                // Maximum items cooked in one pass, unless the item sets its own
+int itemBatchSize[ITEM_COUNT] = {};    // Per-item maximum (0 = use batchSizeLimit)
+int batchMaxWaitMillis = 500;          // Longest an item waits for its batch to fill
+bool batchWaitConfigured = false;      // Whether the config set batchMaxWaitMillis (else the simulation uses taskMillis)
+vector<PendingItem> batchBuckets[ITEM_COUNT];  // Waiting items by food (guarded by batchMutex)
+InstrumentedMutex batchMutex("batchMutex");    // Mutex to protect the batching stage
+condition_variable_any batchCv;        // Condition variable to wake the batcher
+thread batcherThread;                  // Thread that forms and dispatches batches
+bool batcherStop = false;              // Flag to stop the batcher (guarded by batchMutex)
+int batchSequence = 0;                 // Counter for batch job IDs (guarded by batchMutex)
+atomic<long long> batchPasses(0);      // Cook passes dispatched
+atomic<long long> batchedItems(0);     // Items cooked in those passes
+atomic<long long> batchSavedMs(0);     // Cook time saved compared to one pass per item
+
+// Function to credit one cooked item to its order, completing the order when it was the last
+void creditBatchedItem(const shared_ptr<ParkedOrder>& owner) {
+    {
+        lock_guard<InstrumentedMutex> lock(batchMutex);
+        if (--owner->itemsLeft > 0)
+            return;
+    }
+    Order& order = owner->order;
+    if (!completeOrderState(order)) {
+        order.itemsDone = order.foods.size(); // Cancelled while its items were cooking
+        lock_guard<InstrumentedMutex> lock(queueMutex);
+        dropCancelledOrderLocked(order, true);
+        return;
+    }
+    recordCompletion(order);
+    order.isCompleted = true;
+    {
+        lock_guard<InstrumentedMutex> lock(queueMutex);
+        finishOrderLocked(order);
+    }
+    if (consoleLogging)
+        LogLine() << "\nOrder " << order.orderID << " completed by Worker " << order.workerID << " (batch cooked)\n";
+}
+
+// Function for a cook to hand a seated order's items to the batching stage
+void parkOrderForBatching(const Order& order) {
+    auto owner = make_shared<ParkedOrder>();
+    owner->order = order;
+    owner->itemsLeft = (int)order.foods.size();
+    if (owner->itemsLeft == 0) {
+        owner->itemsLeft = 1;
+        creditBatchedItem(owner);
+        return;
+    }
+    auto now = chrono::steady_clock::now();
+    {
+        lock_guard<InstrumentedMutex> lock(batchMutex);
+        for (MenuItem food : order.foods)
+            batchBuckets[food].push_back({ owner, now });
+    }
+    batchCv.notify_one();
+}
+
+// Function to cook one batch as a single recipe pass on the line cooks
+void dispatchBatch(MenuItem food, vector<PendingItem> items, int batchID) {
+    Order passOrder;
+    passOrder.orderID = -batchID; // Negative IDs keep batch passes apart from real orders
+    passOrder.foods = { food };
+    // One pass cooks every item, so it runs at the slowest prep time among the items' menu versions
+    int slowestPct = 0;
+    for (const auto& item : items) {
+        const auto& version = item.owner->order.menuVersion;
+        int pct = version ? version->prepTimePct[food] : baseMenu.prepTimePct[food];
+        if (pct > slowestPct) {
+            slowestPct = pct;
+            passOrder.menuVersion = version;
+        }
+    }
+    auto job = buildDagJob(passOrder);
+    if (!admitDagJob(*job))
+        return;
+    int passPct = 0;
+    for (const auto& node : job->nodes)
+        passPct += node.durationPct;
+    batchPasses++;
+    batchedItems += (long long)items.size();
+    batchSavedMs += (long long)taskMillis * passPct / 100 * ((long long)items.size() - 1);
+    job->onComplete = [items, batchID] {
+        if (bankersEnabled)
+            retireOrder(-batchID);
+        for (const auto& item : items)
+            creditBatchedItem(item.owner);
+    };
+    lock_guard<InstrumentedMutex> lock(dagMutex);
+    pushJobRootsLocked(job);
+}
+
+// Function to get the most items of one food cooked in one pass
+int batchLimit(int food) {
+    return itemBatchSize[food] > 0 ? itemBatchSize[food] : batchSizeLimit;
+}
+
+// Function to turn the batching stage on if any item can be cooked more than one at a time
+void updateBatchingEnabled() {
+    batchingEnabled = false;
+    for (int food = 0; food < ITEM_COUNT; ++food)
+        batchingEnabled = batchingEnabled || batchLimit(food) > 1;
+}
+
+// Function to check whether a bucket holds an item above NORMAL priority (batchMutex held)
+bool bucketHasUrgentItemLocked(const vector<PendingItem>& bucket) {
+    return any_of(bucket.begin(), bucket.end(), [](const PendingItem& item) {
+        return effectivePriority(item.owner->order) > PRIORITY_NORMAL;
+    });
+}
+
+// Function executed by the batcher thread: dispatches full, expired or urgent buckets, and on
+// stop flushes whatever is left
+void batcherFunction() {
+    setTraceThreadName("Batcher");
+    applyPinning("batcher");
+    unique_lock<InstrumentedMutex> lock(batchMutex);
+    while (true) {
+        auto now = chrono::steady_clock::now();
+        auto nextExpiry = chrono::steady_clock::time_point::max();
+        int due = -1;
+        for (int food = 0; food < ITEM_COUNT; ++food) {
+            const vector<PendingItem>& bucket = batchBuckets[food];
+            if (bucket.empty())
+                continue;
+            auto expiry = bucket.front().queuedAt + chrono::milliseconds(batchMaxWaitMillis);
+            if (batcherStop || (int)bucket.size() >= batchLimit(food) || expiry <= now
+                || bucketHasUrgentItemLocked(bucket)) {
+                due = food;
+                break;
+            }
+            nextExpiry = min(nextExpiry, expiry);
+        }
+        if (due >= 0) {
+            // Take the oldest items of the bucket, up to one batch
+            vector<PendingItem>& bucket = batchBuckets[due];
+            size_t take = min(bucket.size(), (size_t)batchLimit(due));
+            vector<PendingItem> items(bucket.begin(), bucket.begin() + take);
+            bucket.erase(bucket.begin(), bucket.begin() + take);
+            MenuItem food = MenuItem(due);
+            int batchID = ++batchSequence;
+            lock.unlock();
+            dispatchBatch(food, move(items), batchID);
+            lock.lock();
+            continue;
+        }
+        if (batcherStop)
+            break;
+        if (nextExpiry == chrono::steady_clock::time_point::max())
+            batchCv.wait(lock);
+        else
+            batchCv.wait_until(lock, nextExpiry);
+    }
+}
+
+// Function to start the batcher thread
+void startBatcher() {
+    lock_guard<InstrumentedMutex> lock(batchMutex);
+    batcherStop = false;
+    batcherThread = thread(batcherFunction);
+}
+
+// Function to stop the batcher thread; pending items are flushed unless this is a hard stop
+void stopBatcher() {
+    if (!batcherThread.joinable())
+        return;
+    {
+        lock_guard<InstrumentedMutex> lock(batchMutex);
+        batcherStop = true;
+        if (hardStopFlag) {
+            for (auto& bucket : batchBuckets)
+                bucket.clear();
+        }
+    }
+    batchCv.notify_all();
+    batcherThread.join();
+}
+
+// Per-item task handlers. The worker loop dispatches through a static table indexed by task
+// number; progress lines are only composed when consoleLogging is on, into the thread's reused
+// LogLine buffer, so the per-item path does not allocate.
+
+// Structure to represent what a per-item task handler works on
+struct TaskContext {
+    const WorkerCredential& worker;   // Worker performing the task
+    Order& order;                     // Order being processed
+};
+
+using TaskHandler = void (*)(TaskContext&, MenuItem);
+
+// Function to serve one item
+void serveItem(TaskContext& ctx, MenuItem item) {
+    if (consoleLogging && itemLogging)
+        LogLine() << "Serving " << soldItemName(ctx.order, item) << "...\n";
+    this_thread::sleep_for(chrono::milliseconds(taskMillis)); // Simulate task duration
+}
+
+// Function to clean the order's table, once per item
+void cleanTableItem(TaskContext& ctx, MenuItem) {
+    if (consoleLogging && itemLogging)
+        LogLine() << "Cleaning Table " << ctx.order.table << "...\n";
+    this_thread::sleep_for(chrono::milliseconds(taskMillis)); // Simulate task duration
+}
+
+// Function to wash the dishes of one item at a sink
+void washDishesItem(TaskContext& ctx, MenuItem) {
+    if (consoleLogging && itemLogging)
+        LogLine() << "Washing Dishes for Table " << ctx.order.table << "...\n";
+    stationPools[STATION_SINK].acquire();
+    this_thread::sleep_for(chrono::milliseconds(taskMillis)); // Dishes occupy a sink
+    stationPools[STATION_SINK].busyMs += taskMillis;
+    stationPools[STATION_SINK].release();
+}
+
+// Function to let the worker manually select a table for the order, if it has none yet
+void selectTableItem(TaskContext& ctx, MenuItem) {
+    bool validTableSelected = ctx.order.table != 0;
+    while (!validTableSelected) {
+        cout << "\nWorker " << ctx.worker.workerId
+            << " (" << ctx.worker.fullName << ") - Choose a table for Order "
+            << ctx.order.orderID << ":\n";
+        displayAvailableTables();
+        cout << "Enter table number: ";
+        int chosenTable;
+        cin >> chosenTable;
+        if (chosenTable < 1 || chosenTable >(int)tables.size()) {
+            cout << "Invalid table number. Try again.\n";
+            continue;
+        }
+        lock_guard<InstrumentedMutex> lock(queueMutex);
+        if (claimTableLocked(chosenTable)) {
+            ctx.order.table = chosenTable;
+            validTableSelected = true;
+        }
+        else {
+            cout << "Table " << chosenTable << " is unavailable. Choose another.\n";
+        }
+    }
+    this_thread::sleep_for(chrono::milliseconds(taskMillis)); // Simulate task duration
+}
+
+// Function for a worker whose task is not valid
+void invalidTaskItem(TaskContext& ctx, MenuItem) {
+    if (consoleLogging && itemLogging)
+        LogLine() << "Invalid task for worker " << ctx.worker.workerId << "\n";
+    this_thread::sleep_for(chrono::milliseconds(taskMillis)); // Simulate task duration
+}
+
+// Per-item handlers indexed by task number; cooks work on whole orders instead (see workerFunction)
+constexpr TaskHandler taskHandlers[TASK_LIMIT] = {
+    invalidTaskItem,   // 0: no task
+    invalidTaskItem,   // Cook (whole-order, never dispatched per item)
+    serveItem,
+    cleanTableItem,
+    washDishesItem,
+    selectTableItem,
+};
+
+// Function to look up the per-item handler for a task number
+TaskHandler taskHandlerFor(int task) {
+    return task > 0 && task < TASK_LIMIT ? taskHandlers[task] : invalidTaskItem;
+}
+
+// Function executed by each worker thread
+void workerFunction(int workerId) {
+    WorkerCredential currentWorker;
+    {
+        // Find the worker's credentials based on their ID
+        auto it = find_if(workerCredentials.begin(), workerCredentials.end(),
+            [workerId](const WorkerCredential& wc) { return wc.workerId == workerId; });
+        if (it != workerCredentials.end()) {
+            currentWorker = *it;
+        }
+    }
+    setTraceThreadName("Worker " + to_string(workerId) + " (" + currentWorker.fullName + ")");
+    applyPinning(taskRole(currentWorker.defaultTask));
+
+    while (true) {
+        // Lock the queue and wait for new orders or shutdown signal
+        unique_lock<InstrumentedMutex> lock(queueMutex);
+        cv.wait(lock, [] { return !orderQueue.empty() || shutdownFlag; });
+        if (hardStopFlag || (shutdownFlag && orderQueue.empty()))
+            break; // Exit on a hard stop, or if shutdown is signaled and no orders are left
+
+        // Retrieve the next order from the queue
+        TraceSpan dequeueSpan("dequeue", "order");
+        Order currentOrder;
+        if (!popOrderLocked(currentOrder))
+            continue; // Only cancelled orders were left
+        lock.unlock();
+        dequeueSpan.event.orderID = currentOrder.orderID;
+        dequeueSpan.end();
+
+        // Assign a table to the order if not already assigned
+        if (currentOrder.table == 0 && currentWorker.defaultTask != TASK_SELECT_TABLE) {
+            TraceSpan tableSpan("assign table", "table", currentOrder.orderID);
+            unique_lock<InstrumentedMutex> tblLock(queueMutex);
+            if (!assignTableLocked(currentOrder)) {
+                // No table is available: the order was requeued. Wait for an order to finish
+                // (which frees a table) rather than spinning on the queue.
+                drainCv.wait_for(tblLock, chrono::milliseconds(max(1, taskMillis)));
+                continue;
+            }
+            tableSpan.event.table = currentOrder.table;
+        }
+
+        // Output the worker's task to the console
+        if (consoleLogging) {
+            LogLine line;
+            line << "\nWorker " << currentWorker.workerId << " (" << currentWorker.fullName
+                << ") is processing Order " << currentOrder.orderID;
+            if (currentOrder.table != 0)
+                line << " (Assigned Table " << currentOrder.table << ")";
+            line << "\n";
+        }
+
+        TraceSpan orderSpan("process order", "order", currentOrder.orderID, currentOrder.table);
+        bool abandoned = false;
+        if (currentWorker.defaultTask == TASK_COOK && batchingEnabled && currentOrder.itemsDone == 0) {
+            // Cooks hand the items to the batching stage; the order completes when they are cooked
+            currentOrder.workerID = currentWorker.workerId;
+            if (consoleLogging)
+                LogLine() << "Batching Order " << currentOrder.orderID << " (" << currentOrder.foods.size() << " items)...\n";
+            parkOrderForBatching(currentOrder);
+            continue;
+        }
+        bool preempted = false, yielded = false, cancelled = false;
+        if (currentWorker.defaultTask == TASK_COOK) {
+            // Cooks run the items of the order as recipe DAGs across the line cooks. Under round
+            // robin each quantum of items is its own DAG, and the rest of the order is handed
+            // back between slices if another order is waiting. Outside round robin an order that
+            // a higher class could preempt is cooked one item per DAG, and between items it is
+            // checkpointed if a higher class is waiting, as the other tasks are; an order of the
+            // top class is cooked as one DAG.
+            chrono::milliseconds makespan(0);
+            if (consoleLogging)
+                LogLine() << "Cooking Order " << currentOrder.orderID << " (" << currentOrder.foods.size() << " items)...\n";
+            size_t sliceItems = cookSliceItems();
+            size_t done = min(currentOrder.itemsDone, currentOrder.foods.size());
+            while (!abandoned && done < currentOrder.foods.size()) {
+                if (orderCancelled(currentOrder)) {
+                    currentOrder.itemsDone = done;
+                    cancelled = true;
+                    break;
+                }
+                if (done > currentOrder.itemsDone) {
+                    bool higherWaiting = kitchenSnapshot().topQueuedPriority > effectivePriority(currentOrder);
+                    if (higherWaiting || sliceItems > 0) {
+                        lock_guard<InstrumentedMutex> lock(queueMutex);
+                        preempted = higherWaiting && shouldPreemptLocked(currentOrder);
+                        yielded = !preempted && sliceItems > 0 && shouldYieldSliceLocked(currentOrder);
+                        if (preempted || yielded) {
+                            currentOrder.itemsDone = done;
+                            checkpointOrderLocked(currentOrder);
+                            (preempted ? preemptions : sliceYields)++;
+                            break;
+                        }
+                    }
+                }
+                size_t step = sliceItems > 0 ? sliceItems
+                    : effectivePriority(currentOrder) < PRIORITY_COUNT - 1 ? 1 : currentOrder.foods.size();
+                size_t end = min(currentOrder.foods.size(), done + step);
+                vector<bool> cooked;
+                if (done == 0 && end == currentOrder.foods.size())
+                    abandoned = !cookOrderDag(currentOrder, makespan, &cooked);
+                else {
+                    Order slice = currentOrder;
+                    slice.foods.assign(currentOrder.foods.begin() + done, currentOrder.foods.begin() + end);
+                    abandoned = !cookOrderDag(slice, makespan, &cooked);
+                }
+                if (!abandoned && orderCancelled(currentOrder)) {
+                    // Cancelled during the job: its skipped steps left some items uncooked. The
+                    // cooked ones move to the front, so the drop gives back the rest's ingredients.
+                    vector<MenuItem> made, unmade;
+                    for (size_t i = done; i < end; ++i)
+                        (cooked[i - done] ? made : unmade).push_back(currentOrder.foods[i]);
+                    copy(made.begin(), made.end(), currentOrder.foods.begin() + done);
+                    copy(unmade.begin(), unmade.end(), currentOrder.foods.begin() + done + made.size());
+                    currentOrder.itemsDone = done + made.size();
+                    cancelled = true;
+                    break;
+                }
+                done = end;
+            }
+        }
+
+        // Perform the worker's task for each food item in the order
+        TaskHandler handler = taskHandlerFor(currentWorker.defaultTask);
+        TaskContext context{ currentWorker, currentOrder };
+        const char* taskName = currentWorker.defaultTask > 0 && currentWorker.defaultTask < TASK_LIMIT
+            ? taskNames[currentWorker.defaultTask - 1] : "No valid task";
+        auto sliceStart = chrono::steady_clock::now();
+        for (size_t i = currentOrder.itemsDone; i < currentOrder.foods.size(); ++i) {
+            if (currentWorker.defaultTask == TASK_COOK)
+                break; // Already cooked as a recipe DAG
+            if (hardStopFlag) {
+                abandoned = true; // Stop at the item boundary on a hard stop
+                break;
+            }
+            if (orderCancelled(currentOrder)) {
+                currentOrder.itemsDone = i;
+                cancelled = true;
+                break;
+            }
+            // Item boundary: a safe point to yield to a higher class, or to hand the rest of the
+            // order back when its round-robin quantum is used up. The published snapshot rules
+            // most checks out without touching queueMutex.
+            if (i > currentOrder.itemsDone) {
+                auto snapshot = kitchenSnapshot();
+                bool higherWaiting = snapshot.topQueuedPriority > effectivePriority(currentOrder);
+                bool sliceDone = snapshot.queuedOrders > 0 && sliceExpired(i - currentOrder.itemsDone, sliceStart);
+                if (higherWaiting || sliceDone) {
+                    lock_guard<InstrumentedMutex> lock(queueMutex);
+                    preempted = higherWaiting && shouldPreemptLocked(currentOrder);
+                    yielded = !preempted && sliceDone && shouldYieldSliceLocked(currentOrder);
+                    if (preempted || yielded) {
+                        currentOrder.itemsDone = i;
+                        checkpointOrderLocked(currentOrder);
+                        (preempted ? preemptions : sliceYields)++;
+                        break;
+                    }
+                }
+            }
+            MenuItem food = currentOrder.foods[i];
+            TraceSpan itemSpan(taskName, "task", currentOrder.orderID, currentOrder.table, soldItemName(currentOrder, food));
+            handler(context, food);
+        }
+        if (preempted || yielded) {
+            if (consoleLogging)
+                LogLine() << "Order " << currentOrder.orderID << " set aside after " << currentOrder.itemsDone
+                    << (preempted ? " items for a higher-priority order\n" : " items (round-robin quantum used up)\n");
+            continue;
+        }
+
+        if (abandoned) {
+            lock_guard<InstrumentedMutex> lock(queueMutex);
+            inFlightOrders--;
+            drainCv.notify_all();
+            break;
+        }
+        if (!cancelled && !completeOrderState(currentOrder)) {
+            currentOrder.itemsDone = currentOrder.foods.size(); // Cancelled as its last item finished
+            cancelled = true;
+        }
+        if (cancelled) {
+            {
+                lock_guard<InstrumentedMutex> lock(queueMutex);
+                dropCancelledOrderLocked(currentOrder, true);
+            }
+            if (consoleLogging)
+                LogLine() << "\nOrder " << currentOrder.orderID << " cancelled after " << currentOrder.itemsDone << " items\n";
+            continue;
+        }
+
+        // Mark the order as completed and release the table
+        orderSpan.end();
+        TraceSpan completeSpan("complete", "order", currentOrder.orderID, currentOrder.table);
+        currentOrder.workerID = currentWorker.workerId;
+        recordCompletion(currentOrder);
+        currentOrder.isCompleted = true;
+
+        {
+            lock_guard<InstrumentedMutex> lock(queueMutex);
+            finishOrderLocked(currentOrder);
+        }
+
+        if (consoleLogging) {
+            LogLine() << "\nOrder " << currentOrder.orderID << " completed by Worker "
+                << currentWorker.workerId << "\n";
+        }
+    }
+}
+
+const int SLA_MIN_STEP_MS = 10; // Step time the SLA assumes at least, so zero-time runs still get real deadlines
+
+// Function to get the service-level target for an order: a fixed allowance plus time per item
+chrono::milliseconds slaTarget(const Order& order) {
+    long long stepMs = max(taskMillis, SLA_MIN_STEP_MS);
+    return chrono::milliseconds(stepMs * (4 + 2 * (long long)order.foods.size()));
+}
+
+long long sampledBusyMs[STATION_COUNT] = {}; // Station busy times at the last sample (guarded by queueMutex)
+chrono::steady_clock::time_point busySampledAt; // When the stations were last sampled (guarded by queueMutex)
+atomic<int> bottleneckPct(0);         // Utilisation of the busiest station over the last interval (written under queueMutex)
+
+// Function to get the utilisation of the busiest station, resampled once per interval (queueMutex held)
+int bottleneckUtilisationLocked(chrono::steady_clock::time_point now) {
+    if (now - busySampledAt < shedInterval())
+        return bottleneckPct;
+    long long elapsedMs = chrono::duration_cast<chrono::milliseconds>(now - busySampledAt).count();
+    bool first = busySampledAt.time_since_epoch().count() == 0;
+    int busiest = 0;
+    for (int st = 0; st < STATION_COUNT; ++st) {
+        long long busy = stationPools[st].busyMs;
+        if (!first)
+            busiest = max(busiest, (int)(100 * (busy - sampledBusyMs[st]) / (elapsedMs * stationCapacity[st])));
+        sampledBusyMs[st] = busy;
+    }
+    busySampledAt = now;
+    bottleneckPct = busiest;
+    return busiest;
+}
+
+// Function to decide, before submitting it, whether to take a new order given the wait it would face
+// 'quote' receives the wait to promise the guest; an idle kitchen always takes the order
+// VIP orders and above are never turned away, only quoted
+// The decision reads the queue's published counts and the controller's atomics, so it is O(1)
+// and never waits for queueMutex: the head's age is fed to the controller only when the lock
+// happens to be free (dispatches feed it too), otherwise the last state is used.
+IntakeDecision decideIntake(const Order& order, chrono::milliseconds& quote) {
+    auto now = chrono::steady_clock::now();
+    auto headAge = orderQueue.headAge(now);
+    int bottleneck = bottleneckPct;
+    {
+        unique_lock<InstrumentedMutex> lock(queueMutex, try_to_lock);
+        if (lock.owns_lock()) {
+            noteSojournLocked(headAge, now);
+            bottleneck = bottleneckUtilisationLocked(now);
+        }
+    }
+    int workerCount = max(1, (int)workerCredentials.size());
+    auto waitAhead = chrono::milliseconds((long long)orderQueue.publishedItemsFrom(effectivePriority(order)) * taskMillis / workerCount);
+    quote = waitAhead + chrono::milliseconds((long long)order.foods.size() * taskMillis / workerCount);
+    chrono::milliseconds maxWait = shedMaxWaitMs > 0 ? chrono::milliseconds(shedMaxWaitMs) : 5 * shedTarget();
+    IntakeDecision decision = INTAKE_ACCEPT;
+    if ((sheddingLoad || waitAhead > maxWait) && effectivePriority(order) < PRIORITY_VIP)
+        decision = INTAKE_REJECT;
+    else if (waitAhead > shedTarget() || sojournAboveSince.load().time_since_epoch().count() != 0
+        || bottleneck >= 90) {
+        // A queue is standing or a station is saturated: the order waits at least as long as the head has
+        decision = INTAKE_QUOTE_LONGER;
+        quote = max(quote, chrono::duration_cast<chrono::milliseconds>(headAge));
+    }
+    intakeDecisions[decision]++;
+    return decision;
+}
+
+// Function to submit a new order to the kitchen (returns false once intake is closed).
+// Stamps the arrival time and, unless one was set, the promised-by deadline. If estimatedWait
+// is given it receives the estimated time until the order is ready.
+bool submitOrder(Order order, chrono::milliseconds* estimatedWait = nullptr) {
+    TraceSpan enqueueSpan("enqueue", "order", order.orderID, order.table);
+    if (!order.menuVersion)
+        order.menuVersion = currentMenu(); // Bind to the menu in force when the order is placed
+    order.arrivalTime = chrono::steady_clock::now();
+    if (order.deadline.time_since_epoch().count() == 0)
+        order.deadline = order.arrivalTime + slaTarget(order);
+    {
+        lock_guard<InstrumentedMutex> lock(queueMutex);
+        if (!intakeOpen)
+            return false;
+        if (estimatedWait != nullptr) {
+            int workerCount = max(1, (int)workerCredentials.size());
+            int items = orderQueue.itemsAhead(order) + (int)order.foods.size();
+            *estimatedWait = chrono::milliseconds((long long)items * taskMillis / workerCount);
+        }
+        orderQueue.push(order);
+        publishSnapshotLocked();
+    }
+    cv.notify_one();
+    return true;
+}
+
+// Function to start one worker thread per registered worker and open intake
+void startKitchen(vector<thread>& workers) {
+    shutdownFlag = false;
+    hardStopFlag = false;
+    intakeOpen = true;
+    resetStations();
+    kitchenStartTime = chrono::steady_clock::now();
+    {
+        lock_guard<InstrumentedMutex> lock(queueMutex);
+        sojournAboveSince = chrono::steady_clock::time_point();
+        sheddingLoad = false;
+        busySampledAt = {};
+        publishSnapshotLocked();
+    }
+    startLineCooks();
+    if (batchingEnabled)
+        startBatcher();
+    workers.reserve(workers.size() + workerCredentials.size());
+    for (const auto& wc : workerCredentials) {
+        workers.emplace_back(workerFunction, wc.workerId);
+    }
+}
+
+// Function to stop intake and let the workers finish every queued and in-flight order.
+// If the kitchen is still busy when the deadline expires, the remaining work is abandoned
+// at the next item boundary (hard stop). Returns the time the drain took.
+chrono::milliseconds stopKitchen(vector<thread>& workers, chrono::milliseconds deadline) {
+    auto drainStart = chrono::steady_clock::now();
+    {
+        unique_lock<InstrumentedMutex> lock(queueMutex);
+        intakeOpen = false;
+        bool idle = drainCv.wait_until(lock, drainStart + deadline,
+            [] { return orderQueue.empty() && inFlightOrders == 0; });
+        if (!idle)
+            hardStopFlag = true;
+        shutdownFlag = true;
+    }
+    cv.notify_all();
+    {
+        lock_guard<InstrumentedMutex> lock(dagMutex); // Wake workers waiting on a recipe DAG
+        dagCv.notify_all();
+    }
+    {
+        lock_guard<InstrumentedMutex> lock(bankerMutex); // Wake orders waiting for admission or a station
+        bankerCv.notify_all();
+    }
+    for (auto& worker : workers)
+        worker.join();
+    workers.clear();
+    stopBatcher();
+    stopLineCooks();
+    return chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - drainStart);
+}
+
+// Function to drain the kitchen with no deadline: returns as soon as all work is done
+chrono::milliseconds drainKitchen(vector<thread>& workers) {
+    return stopKitchen(workers, chrono::hours(24 * 365));
+}
+
+// Hot menu reload: with --menu <file>, a watcher thread publishes the file as a new menu version
+// whenever it changes, while the kitchen keeps running. Lines of the file:
+//   item.<item> = <shown name>, <price>[, <prep time %>]    reprice or rename an item
+//   86 = <item>, ...                                        items taken off the menu
+//   special = <item>, ...                                   items shown as specials
+// Items the file does not mention revert to the base menu (the built-in or configured one).
+string menuPath;                        // Menu file watched for changes ("" = none)
+atomic<bool> menuWatcherStop(false);    // Flag to stop the watcher
+thread menuWatcherThread;               // Thread that reloads the menu file
+atomic<long long> menuReloads(0);       // Menu versions published from the file
+
+// Function to fill a menu version from the base menu, keeping its version number
+void fillBaseMenu(MenuVersion& version) {
+    int number = version.version;
+    version = baseMenu;
+    version.version = number;
+}
+
+// Function to publish the base menu as the current version (at startup and after the config is loaded)
+void publishBaseMenu() {
+    updateMenu(fillBaseMenu);
+}
+
+// Function to print the outcome of a drain
+void reportDrain(chrono::milliseconds drainTime) {
+    lock_guard<InstrumentedMutex> lock(queueMutex);
+    cout << "\nKitchen drained in " << drainTime.count() << " ms ("
+        << completedOrders.size() << " orders completed";
+    if (hardStopFlag)
+        cout << ", hard stop: " << orderQueue.size() << " queued orders abandoned";
+    cout << ").\n";
+    if (ordersOnTime + deadlineMisses > 0) {
+        cout << "Deadlines (" << (dispatchPolicy == DISPATCH_EDF ? "EDF" : "FCFS") << "): "
+            << 100 * ordersOnTime / (ordersOnTime + deadlineMisses) << "% on time, "
+            << deadlineMisses << " missed";
+        if (deadlineMisses > 0)
+            cout << " by " << totalLatenessMs / deadlineMisses << " ms on average";
+        cout << "\n";
+    }
+    if (lowStockEvents > 0 || ordersOutOfStock > 0) {
+        cout << "Inventory: " << ordersOutOfStock << " orders refused for missing ingredients, "
+            << lowStockEvents << " low-stock events\n";
+        displayLowStock();
+    }
+    if (batchPasses > 0) {
+        cout << "Batching: " << batchedItems << " items in " << batchPasses << " cook passes (avg "
+            << (double)batchedItems / batchPasses << " per pass), " << batchSavedMs
+            << " ms of cook time saved vs one pass per item\n";
+    }
+    if (dagMakespanMs > 0) {
+        cout << "Recipe DAG cooking: " << dagMakespanMs << " ms makespan vs "
+            << dagSerialMs << " ms serial (" << lineCookCount << " line cooks)\n";
+    }
+
+    // Station utilisation over the run, and admission control counters
+    long long runMs = max<long long>(1, chrono::duration_cast<chrono::milliseconds>(
+        chrono::steady_clock::now() - kitchenStartTime).count());
+    cout << "Station utilisation:\n";
+    for (int st = 0; st < STATION_COUNT; ++st) {
+        if (stationPools[st].acquisitions == 0)
+            continue;
+        cout << "  " << stationNames[st] << " x" << stationCapacity[st] << ": "
+            << 100 * stationPools[st].busyMs / (runMs * stationCapacity[st]) << "% busy, "
+            << stationPools[st].acquisitions << " uses, " << stationPools[st].waits << " waits\n";
+    }
+    if (loadShedding) {
+        cout << "Load shedding: " << intakeDecisions[INTAKE_ACCEPT] << " orders accepted, "
+            << intakeDecisions[INTAKE_QUOTE_LONGER] << " quoted a longer wait, " << intakeDecisions[INTAKE_REJECT]
+            << " turned away; sojourn peaked at " << sojournPeakMs << " ms (target " << shedTarget().count()
+            << " ms), shedding started " << sheddingEpisodes << " times\n";
+    }
+    if (bankersEnabled) {
+        cout << "Banker's admission: " << admissionsTotal << " admitted, " << admissionsDelayed
+            << " delayed, " << admissionWaitMs << " ms total admission wait\n";
+    }
+    if (preemptions > 0 || classCompleted[PRIORITY_NORMAL] != (long long)completedOrders.size()) {
+        cout << "Priority classes:";
+        for (int p = 0; p < PRIORITY_COUNT; ++p)
+            if (classCompleted[p] > 0)
+                cout << " " << priorityNames[p] << " " << classCompleted[p] << " (avg "
+                    << classLatencyMs[p] / classCompleted[p] << " ms)";
+        cout << "; " << preemptions << " preemptions, " << priorityBoosts << " table priority inheritances\n";
+    }
+    if (ordersUnseated > 0)
+        cout << "Reservations: " << ordersUnseated << " orders dropped at closing, every free table held for a booking\n";
+    if (cancelledQueued + cancelledInProgress + ordersModified > 0) {
+        cout << "Cancellations: " << cancelledQueued << " skipped in the queue, " << cancelledInProgress
+            << " stopped in progress; " << ordersModified << " orders changed while queued\n";
+    }
+    if (sliceQuantumItems > 0 || sliceQuantumMillis > 0) {
+        long long completed = 0, latencyMs = 0;
+        for (int p = 0; p < PRIORITY_COUNT; ++p) {
+            completed += classCompleted[p];
+            latencyMs += classLatencyMs[p];
+        }
+        cout << "Round robin (quantum ";
+        if (sliceQuantumItems > 0)
+            cout << sliceQuantumItems << " items";
+        if (sliceQuantumMillis > 0)
+            cout << (sliceQuantumItems > 0 ? ", " : "") << sliceQuantumMillis << " ms";
+        cout << "): " << sliceYields << " orders handed back, avg turnaround "
+            << latencyMs / max(1LL, completed) << " ms\n";
+    }
+    if (menuReloads > 0)
+        cout << "Menu: version " << currentMenu()->version << " live, " << menuReloads << " versions published from "
+            << menuPath << " during service\n";
+    printAnalyticsReport();
+    if (lockInstrumentation)
+        printLockReport();
+}
+
+// Configuration: one "key = value" file, read once at startup (--config <file>). Everything the
+// engine allocates per table, per worker or per order is sized from it before service starts.
+//   tables, waiting_list, queue_capacity, expected_orders   sizes of the engine's structures
+//   orders, task_ms, run_seconds                            simulation volume and timing
+//   line_cooks, station.<station>, stock.<ingredient>       kitchen capacities
+//   item.<item> = <shown name>, <price>, <prep time %>      the built-in menu items
+//   worker = <id>, <task>, <full name>                      roster, one line per worker
+//   dispatch (fcfs/edf), rr_quantum (<n> or <n>ms), batch_size, bankers (yes/no)
+//   batch_size.<item>                                       batch size of one item
+//   batch_wait_ms                                           longest an item waits for its batch
+//   load_shedding (yes/no), shed_target_ms, shed_interval_ms, shed_max_wait_ms
+//   log (off/orders/items), log_sink (stdout/ring/<path>)
+// '#' starts a comment. Names are matched without case or spaces, e.g. "station.oven".
+bool kitchenConfigured = false;  // Whether a config file was loaded
+int configuredOrders = 100;      // Orders a configured simulation generates
+int runSeconds = 0;              // Drain deadline of a configured simulation (0 = none)
+size_t queueCapacity = 256;      // Orders each priority lane's EDF heap is sized for
+size_t expectedOrders = 1024;    // Completed orders the history is sized for
+
+// Function to normalise a config name: lower case, spaces removed
+string configName(const string& text) {
+    string name;
+    for (char c : text)
+        if (!isspace((unsigned char)c))
+            name += (char)tolower((unsigned char)c);
+    return name;
+}
+
+// Function to strip leading and trailing whitespace
+string trimmed(const string& text) {
+    size_t first = text.find_first_not_of(" \t\r");
+    if (first == string::npos)
+        return "";
+    return text.substr(first, text.find_last_not_of(" \t\r") - first + 1);
+}
+
+// Function to find a name in a list of names (index, or -1)
+template <typename Names>
+int findConfigName(const Names& names, int count, const string& wanted) {
+    for (int i = 0; i < count; ++i)
+        if (configName(names[i]) == wanted)
+            return i;
+    return -1;
+}
+
+// Function to find a menu item by its built-in or base name (-1 if there is none)
+int findMenuItem(const string& name) {
+    for (int i = 0; i < ITEM_COUNT; ++i)
+        if (configName(menu[i].name) == name || configName(baseMenu.names[i]) == name)
+            return i;
+    return -1;
+}
+
+// Function to apply one "key = value" setting; returns an error message, or "" if it was applied
+string applyConfigSetting(const string& key, const string& value) {
+    size_t dot = key.find('.');
+    string group = key.substr(0, dot), name = dot == string::npos ? "" : key.substr(dot + 1);
+    if (key == "tables")
+        tables.assign(max(1, stoi(value)), true);
+    else if (key == "waiting_list")
+        waitingListCapacity = max(0, stoi(value));
+    else if (key == "queue_capacity")
+        queueCapacity = (size_t)max(0, stoi(value));
+    else if (key == "expected_orders")
+        expectedOrders = (size_t)max(0, stoi(value));
+    else if (key == "orders")
+        configuredOrders = max(0, stoi(value));
+    else if (key == "task_ms")
+        taskMillis = max(0, stoi(value));
+    else if (key == "run_seconds")
+        runSeconds = max(0, stoi(value));
+    else if (key == "line_cooks")
+        lineCookCount = max(1, stoi(value));
+    else if (group == "station" && !name.empty()) {
+        int st = findConfigName(stationNames, STATION_COUNT, name);
+        if (st < 0)
+            return "unknown station '" + name + "'";
+        stationCapacity[st] = max(1, stoi(value));
+    }
+    else if (group == "stock" && !name.empty()) {
+        int ing = findConfigName(ingredientNames, ING_COUNT, name);
+        if (ing < 0)
+            return "unknown ingredient '" + name + "'";
+        initialStock[ing] = max(0, stoi(value));
+    }
+    else if (group == "item" && !name.empty()) {
+        int item = findMenuItem(name);
+        if (item < 0)
+            return "unknown menu item '" + name + "' (only the built-in items can be configured)";
+        stringstream fields(value);
+        string shown, price, prep;
+        if (!getline(fields, shown, ',') || !getline(fields, price, ',') || !getline(fields, prep))
+            return "expected <shown name>, <price>, <prep time %>";
+        if (!isItemName(trimmed(shown)))
+            return "item names must be non-empty and may not contain ';' or '\"'";
+        baseMenu.names[item] = trimmed(shown);
+        baseMenu.priceCents[item] = (int)llround(stod(price) * 100);
+        baseMenu.prepTimePct[item] = max(1, stoi(prep));
+    }
+    else if (key == "worker") {
+        stringstream fields(value);
+        string id, task, fullName;
+        if (!getline(fields, id, ',') || !getline(fields, task, ',') || !getline(fields, fullName))
+            return "expected <id>, <task>, <full name>";
+        WorkerCredential wc;
+        wc.workerId = stoi(id);
+        wc.fullName = trimmed(fullName);
+        int taskIndex = findConfigName(taskNames, TASK_LIMIT - 1, configName(task));
+        string taskNumber = trimmed(task);
+        bool numeric = !taskNumber.empty() && all_of(taskNumber.begin(), taskNumber.end(), [](char c) { return isdigit((unsigned char)c); });
+        wc.defaultTask = taskIndex >= 0 ? taskIndex + 1 : numeric ? stoi(taskNumber) : 0;
+        if (wc.defaultTask < TASK_COOK || wc.defaultTask >= TASK_LIMIT)
+            return "unknown task '" + trimmed(task) + "'";
+        if (!usedWorkerIds.insert(wc.workerId).second)
+            return "worker ID " + to_string(wc.workerId) + " used twice";
+        workerCredentials.push_back(wc);
+    }
+    else if (key == "dispatch") {
+        if (value != "fcfs" && value != "edf")
+            return "dispatch must be fcfs or edf";
+        dispatchPolicy = value == "edf" ? DISPATCH_EDF : DISPATCH_FCFS;
+    }
+    else if (key == "rr_quantum") {
+        if (value.size() > 2 && value.compare(value.size() - 2, 2, "ms") == 0)
+            sliceQuantumMillis = max(0, stoi(value));
+        else
+            sliceQuantumItems = max(0, stoi(value));
+    }
+    else if (key == "batch_size") {
+        batchSizeLimit = max(1, stoi(value));
+        updateBatchingEnabled();
+    }
+    else if (key == "batch_wait_ms") {
+        batchMaxWaitMillis = max(0, stoi(value));
+        batchWaitConfigured = true;
+    }
+    else if (group == "batch_size" && !name.empty()) {
+        int item = findMenuItem(name);
+        if (item < 0)
+            return "unknown menu item '" + name + "'";
+        itemBatchSize[item] = max(1, stoi(value));
+        updateBatchingEnabled();
+    }
+    else if (key == "bankers")
+        bankersEnabled = value == "yes" || value == "true" || value == "1";
+    else if (key == "load_shedding")
+        loadShedding = value == "yes" || value == "true" || value == "1";
+    else if (key == "shed_target_ms")
+        shedTargetMs = max(0, stoi(value));
+    else if (key == "shed_interval_ms")
+        shedIntervalMs = max(0, stoi(value));
+    else if (key == "shed_max_wait_ms")
+        shedMaxWaitMs = max(0, stoi(value));
+    else if (key == "log") {
+        if (value != "off" && value != "orders" && value != "items")
+            return "log must be off, orders or items";
+        consoleLogging = value != "off";
+        itemLogging = value == "items";
+    }
+    else if (key == "log_sink") {
+        if (!setLogSink(value))
+            return "cannot open " + value;
+    }
+    else
+        return "unknown key '" + key + "'";
+    return "";
+}
+
+// Function to size the engine's structures from the configuration, before any thread starts.
+// Service then runs without reallocating them: tables, bookings, the EDF heaps, the history, the
+// roster, the analytics slots and the per-thread trace and analytics registries. FIFO lanes are
+// deques: they grow a block at a time during service but never move the orders already queued.
+void sizeKitchen() {
+    lock_guard<InstrumentedMutex> lock(queueMutex);
+    tableBoost.assign(tables.size(), PRIORITY_NORMAL);
+    {
+        lock_guard<InstrumentedMutex> bookingLock(reservationMutex);
+        size_t dropped = 0;
+        for (size_t t = tables.size(); t < reservationBook.size(); ++t)
+            dropped += reservationBook[t].size();
+        if (dropped > 0)
+            cout << "Dropped " << dropped << " reservations on tables beyond table " << tables.size() << "\n";
+        reservationBook.resize(tables.size()); // Bookings on the remaining tables are kept
+    }
+    for (auto& lane : orderQueue.lanes)
+        lane.edf.reserve(queueCapacity);
+    completedOrders.reserve(expectedOrders);
+    waitingList.reserve(waitingListCapacity);
+    analyticsTableSlots = max(analyticsTableSlots, (int)tables.size());
+    for (const auto& wc : workerCredentials)
+        analyticsWorkerSlots = max(analyticsWorkerSlots, min(wc.workerId + 1, 1 << 16)); // Stray huge IDs share the last slot
+    size_t threadCount = workerCredentials.size() + lineCookCount + 8; // Workers, line cooks, helpers
+    analyticsShards.reserve(threadCount);
+    traceBuffers.reserve(threadCount);
+    publishSnapshotLocked();
+}
 
-// List of task names corresponding to worker tasks
-const vector<string> taskNames = { "Cook", "Serve", "Clean Table", "Wash Dishes", "Select Table" };
+// Function to load the config file and size the kitchen from it. Every problem is reported with
+// its line number; the kitchen is sized only if there was none. Returns false otherwise.
+bool loadKitchenConfig(const string& path) {
+    auto start = chrono::steady_clock::now();
+    ifstream in(path);
+    if (!in) {
+        cout << "Could not open config " << path << "\n";
+        return false;
+    }
+    string line;
+    int lineNumber = 0, errors = 0;
+    while (getline(in, line)) {
+        lineNumber++;
+        line = trimmed(line.substr(0, line.find('#')));
+        if (line.empty())
+            continue;
+        size_t eq = line.find('=');
+        string error;
+        if (eq == string::npos)
+            error = "expected key = value";
+        else {
+            try {
+                error = applyConfigSetting(configName(line.substr(0, eq)), trimmed(line.substr(eq + 1)));
+            }
+            catch (const exception&) {
+                error = "bad number";
+            }
+        }
+        if (!error.empty()) {
+            cout << path << ":" << lineNumber << ": " << error << "\n";
+            errors++;
+        }
+    }
+    if (errors > 0) {
+        cout << "Config " << path << ": " << errors << (errors == 1 ? " error" : " errors") << ", kitchen not sized\n";
+        return false;
+    }
+    sizeKitchen();
+    resetInventory();
+    publishBaseMenu();
+    kitchenConfigured = true;
+    cout << "Config " << path << ": " << tables.size() << " tables, " << workerCredentials.size() << " workers, "
+        << lineCookCount << " line cooks, loaded and sized in "
+        << chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count() / 1000.0 << " ms\n";
+    return true;
+}
 
-// Shared resources
-queue<Order> orderQueue;       // Queue to hold orders
-mutex queueMutex;              // Mutex to protect access to the order queue
-condition_variable cv;         // Condition variable to notify workers of new orders
-mutex coutMutex;               // Mutex to protect console output
-vector<bool> tables(5, true);  // Vector to track table availability (true = available)
-vector<Order> completedOrders; // List of completed orders
-vector<string> waitingList;    // List of guests in the waiting list
-int orderCounter = 1;          // Counter to generate unique order IDs
-bool shutdownFlag = false;     // Flag to signal shutdown to worker threads
+// Function to read a menu file and publish it as a new version. Every problem is reported with
+// its line number; returns the published version, or 0 (nothing published) if there was any.
+int reloadMenu(istream& in, const string& source) {
+    MenuVersion next;
+    fillBaseMenu(next);
+    string line;
+    int lineNumber = 0, errors = 0;
+    while (getline(in, line)) {
+        lineNumber++;
+        line = trimmed(line.substr(0, line.find('#')));
+        if (line.empty())
+            continue;
+        size_t eq = line.find('=');
+        string key = eq == string::npos ? "" : configName(line.substr(0, eq));
+        string value = eq == string::npos ? "" : trimmed(line.substr(eq + 1));
+        string error;
+        try {
+            if (key == "86" || key == "special") {
+                stringstream items(value);
+                string name;
+                while (getline(items, name, ',')) {
+                    int item = findMenuItem(configName(name));
+                    if (item < 0)
+                        error = "unknown menu item '" + trimmed(name) + "'";
+                    else if (key == "86")
+                        next.available[item] = false;
+                    else
+                        next.special[item] = true;
+                }
+            }
+            else if (key.compare(0, 5, "item.") == 0) {
+                int item = findMenuItem(key.substr(5));
+                stringstream fields(value);
+                string shown, price, prep;
+                if (item < 0)
+                    error = "unknown menu item '" + key.substr(5) + "'";
+                else if (!getline(fields, shown, ',') || !getline(fields, price, ','))
+                    error = "expected <shown name>, <price>[, <prep time %>]";
+                else if (!isItemName(trimmed(shown)))
+                    error = "item names must be non-empty and may not contain ';' or '\"'";
+                else {
+                    next.names[item] = trimmed(shown);
+                    next.priceCents[item] = (int)llround(stod(price) * 100);
+                    if (getline(fields, prep))
+                        next.prepTimePct[item] = max(1, stoi(prep));
+                }
+            }
+            else
+                error = eq == string::npos ? "expected key = value" : "unknown key '" + key + "'";
+        }
+        catch (const exception&) {
+            error = "bad number";
+        }
+        if (!error.empty()) {
+            LogLine() << source << ":" << lineNumber << ": " << error << "\n";
+            errors++;
+        }
+    }
+    if (errors > 0)
+        return 0;
+    return updateMenu([&next](MenuVersion& version) {
+        next.version = version.version;
+        version = next;
+    });
+}
 
-vector<WorkerCredential> workerCredentials; // List of registered workers
-set<int> usedWorkerIds;                     // Set of used worker IDs to ensure uniqueness
+// Function executed by the menu watcher: publishes the menu file whenever its timestamp changes
+void menuWatcherFunction() {
+    setTraceThreadName("Menu watcher");
+    filesystem::file_time_type seen{};
+    while (!menuWatcherStop) {
+        error_code ec;
+        auto stamp = filesystem::last_write_time(menuPath, ec);
+        if (!ec && stamp != seen) {
+            seen = stamp;
+            ifstream in(menuPath);
+            int version = reloadMenu(in, menuPath);
+            if (version != 0) {
+                menuReloads++;
+                LogLine() << "Menu version " << version << " published from " << menuPath << "\n";
+            }
+        }
+        this_thread::sleep_for(chrono::milliseconds(100));
+    }
+}
 
-// Function to display the status of tables
-void displayAvailableTables() {
-    cout << "\nTable Status:\n";
+// Function to stop the menu watcher, if it runs
+void stopMenuWatcher() {
+    menuWatcherStop = true;
+    if (menuWatcherThread.joinable())
+        menuWatcherThread.join();
+}
+
+// Function to start watching the menu file
+void startMenuWatcher(const string& path) {
+    menuPath = path;
+    menuWatcherStop = false;
+    menuWatcherThread = thread(menuWatcherFunction);
+    atexit(stopMenuWatcher); // Also on exit() paths: a running std::thread must not be destroyed
+}
+
+// Function to register one worker per automatic task (Select Table needs console input)
+void registerAutomaticWorkers(const string& namePrefix) {
+    for (int task = TASK_COOK; task < TASK_SELECT_TABLE; ++task) {
+        WorkerCredential wc;
+        wc.workerId = task;
+        wc.fullName = namePrefix + taskNames[task - 1];
+        wc.defaultTask = task;
+        workerCredentials.push_back(wc);
+        usedWorkerIds.insert(wc.workerId);
+    }
+}
+
+// Deterministic schedule explorer. Virtual guests and workers run on a single thread, and each
+// step is one of the core kitchen operations above. A seeded random scheduler or a systematic
+// (depth-first, odometer-style) enumeration picks which virtual thread steps next, so every
+// interleaving is reproducible. Invariants are checked after every step.
+
+// Structure to represent one virtual thread of the explorer
+struct VirtualThread {
+    bool isGuest;              // Guest submitting orders, or worker processing them
+    int phase;                 // Worker: 0 = idle, 1 = needs table, 2 = working; guest: orders left
+    Order order;               // Order the worker is holding
+    size_t itemsDone;          // Items of the held order already processed
+};
+
+// Structure to represent the outcome of one explored schedule
+struct ScheduleResult {
+    bool violation;            // An invariant failed
+    bool truncated;            // The step bound was hit before the run finished
+    string message;            // Description of the violation
+    vector<int> trace;         // Virtual thread chosen at each step
+};
+
+// Function to reset the shared kitchen state between explored schedules
+void resetKitchenState(int tableCount) {
+    lock_guard<InstrumentedMutex> lock(queueMutex);
+    orderQueue.clear();
+    tables.assign(tableCount, true);
+    tableBoost.assign(tableCount, PRIORITY_NORMAL);
+    completedOrders.clear();
+    inFlightOrders = 0;
+    publishSnapshotLocked();
+}
+
+// Function to check the table invariant: every unavailable table is held by exactly one order
+string checkTableInvariant(const vector<VirtualThread>& threads) {
+    vector<int> holders(tables.size(), 0);
+    for (const auto& vt : threads)
+        if (!vt.isGuest && vt.phase == 2 && vt.order.table > 0)
+            holders[vt.order.table - 1]++;
+    auto countHolder = [&holders](const Order& queued) {
+        if (queued.table > 0)
+            holders[queued.table - 1]++;
+    };
+    for (const auto& lane : orderQueue.lanes) {
+        for_each(lane.fifo.begin(), lane.fifo.end(), countHolder);
+        for_each(lane.edf.contents().begin(), lane.edf.contents().end(), countHolder);
+    }
     for (size_t i = 0; i < tables.size(); ++i) {
-        cout << "Table " << i + 1 << ": " << (tables[i] ? "Available" : "Unavailable") << endl;
+        if (holders[i] > 1)
+            return "table " + to_string(i + 1) + " held by " + to_string(holders[i]) + " orders";
+        if (!tables[i] && holders[i] == 0)
+            return "table " + to_string(i + 1) + " leaked (unavailable with no holder)";
+        if (tables[i] && holders[i] != 0)
+            return "table " + to_string(i + 1) + " available while an order holds it";
     }
-    cout << endl;
+    return "";
 }
 
-// Function to display the food menu
-void displayFoodMenu(const vector<string>& foodList) {
-    cout << "Available Food Items:\n";
-    for (size_t i = 0; i < foodList.size(); ++i) {
-        cout << i + 1 << ". " << foodList[i] << endl;
+// Function to run one schedule. 'choose' picks the index of the next runnable virtual thread.
+template <typename Chooser>
+ScheduleResult runSchedule(int workerCount, int orderCount, int tableCount, int maxSteps, Chooser choose) {
+    ScheduleResult result{ false, false, "", {} };
+    resetKitchenState(tableCount);
+    vector<VirtualThread> threads;
+    threads.push_back({ true, orderCount, Order(), 0 });
+    for (int w = 0; w < workerCount; ++w)
+        threads.push_back({ false, 0, Order(), 0 });
+    int nextOrderID = 1;
+
+    for (int step = 0; step < maxSteps; ++step) {
+        lock_guard<InstrumentedMutex> lock(queueMutex);
+        bool intakeDone = threads[0].phase == 0;
+        if (intakeDone && orderQueue.empty() && inFlightOrders == 0) {
+            // Drained: every order must have completed exactly once
+            set<OrderId> seen;
+            for (const auto& order : completedOrders)
+                if (!seen.insert(order.orderID).second)
+                    result.message = "order " + to_string(order.orderID) + " completed twice";
+            if (result.message.empty() && (int)seen.size() != orderCount)
+                result.message = to_string(orderCount - (int)seen.size()) + " orders lost";
+            result.violation = !result.message.empty();
+            return result;
+        }
+
+        vector<int> runnable;
+        for (size_t t = 0; t < threads.size(); ++t) {
+            const VirtualThread& vt = threads[t];
+            if (vt.isGuest ? vt.phase > 0 : (vt.phase != 0 || !orderQueue.empty()))
+                runnable.push_back((int)t);
+        }
+        if (runnable.empty()) {
+            result.violation = true;
+            result.message = "no runnable thread before drain (lost wakeup or deadlock)";
+            return result;
+        }
+        int t = runnable[choose((int)runnable.size()) % runnable.size()];
+        result.trace.push_back(t);
+        VirtualThread& vt = threads[t];
+
+        if (vt.isGuest) {
+            // Odd orders come from guests who pick a table, even ones are seated by a worker
+            Order order;
+            order.orderID = nextOrderID++;
+            order.foods = { ITEM_SALAD };
+            order.table = 0;
+            order.isCompleted = false;
+            order.workerID = 0;
+            int wanted = 1 + order.orderID % tableCount;
+            if (order.orderID % 2 == 1 && claimTableLocked(wanted))
+                order.table = wanted;
+            orderQueue.push(order);
+            vt.phase--;
+        }
+        else if (vt.phase == 0) {
+            popOrderLocked(vt.order);
+            vt.itemsDone = 0;
+            vt.phase = vt.order.table == 0 ? 1 : 2;
+        }
+        else if (vt.phase == 1) {
+            vt.phase = assignTableLocked(vt.order) ? 2 : 0;
+        }
+        else if (vt.itemsDone < vt.order.foods.size()) {
+            vt.itemsDone++;
+        }
+        else {
+            finishOrderLocked(vt.order);
+            vt.phase = 0;
+        }
+
+        result.message = checkTableInvariant(threads);
+        if (!result.message.empty()) {
+            result.violation = true;
+            return result;
+        }
     }
+    result.truncated = true;
+    return result;
 }
 
-// Function to display the waiting list
-void displayWaitingList() {
-    cout << "\nCurrent Waiting List (" << waitingList.size() << "/10):\n";
-    for (const auto& guest : waitingList) {
-        cout << "- " << guest << endl;
+// Function to print a violating schedule so it can be replayed
+void reportViolation(const string& mode, long long run, const ScheduleResult& result) {
+    cout << "VIOLATION (" << mode << " run " << run << "): " << result.message << "\nSchedule:";
+    for (int t : result.trace)
+        cout << " " << (t == 0 ? string("G") : "W" + to_string(t));
+    cout << "\n";
+}
+
+// Function to explore schedules: 'runs' seeded random ones, then systematic enumeration
+// of a smaller configuration up to 'runs' schedules. Returns the number of violations.
+int exploreSchedules(unsigned seed, long long runs) {
+    int violations = 0;
+    long long truncated = 0;
+    for (long long run = 0; run < runs; ++run) {
+        mt19937 rng(seed + (unsigned)run);
+        ScheduleResult result = runSchedule(3, 6, 2, 400, [&rng](int n) { return (int)(rng() % n); });
+        truncated += result.truncated;
+        if (result.violation && violations++ < 5)
+            reportViolation("random seed " + to_string(seed + run), run, result);
     }
-    cout << "-----------------------------\n";
+    cout << "Random exploration: " << runs << " schedules, " << truncated << " hit the step bound\n";
+
+    // Systematic: replay a prefix of recorded choices, extend with 0, then advance like an odometer
+    vector<pair<int, int>> choices; // (choice taken, number of options) at each step
+    long long explored = 0;
+    truncated = 0;
+    bool exhausted = false;
+    while (!exhausted && explored < runs) {
+        size_t depth = 0;
+        ScheduleResult result = runSchedule(2, 3, 1, 60, [&choices, &depth](int n) {
+            if (depth == choices.size())
+                choices.push_back({ 0, n });
+            return choices[depth++].first;
+        });
+        choices.resize(depth);
+        explored++;
+        truncated += result.truncated;
+        if (result.violation && violations++ < 5)
+            reportViolation("systematic", explored, result);
+        while (!choices.empty() && ++choices.back().first >= choices.back().second)
+            choices.pop_back();
+        exhausted = choices.empty();
+    }
+    cout << "Systematic exploration: " << explored << " schedules" << (exhausted ? " (exhaustive)" : " (bounded)")
+        << ", " << truncated << " hit the step bound\n";
+    cout << violations << " invariant violations\n";
+    return violations;
 }
 
-// Function executed by each worker thread
-void workerFunction(int workerId) {
-    WorkerCredential currentWorker;
-    {
-        // Find the worker's credentials based on their ID
-        auto it = find_if(workerCredentials.begin(), workerCredentials.end(),
-            [workerId](const WorkerCredential& wc) { return wc.workerId == workerId; });
-        if (it != workerCredentials.end()) {
-            currentWorker = *it;
+// Function to run the real worker threads against concurrent intake threads with no task
+// delay. Build with -fsanitize=thread to have ThreadSanitizer check the hot path.
+int stressKitchen(int orderCount) {
+    taskMillis = 0;
+    if (logSink == LOG_STDOUT) {
+        // Worker messages go to the ring, which is checked for torn messages afterwards
+        consoleLogging = true;
+        logSink = LOG_RING;
+    }
+    registerAutomaticWorkers("Stress ");
+    vector<thread> workers;
+    startKitchen(workers);
+    // A dashboard polls the published snapshot the whole time; it must never see a version go
+    // backwards or a snapshot whose counts do not add up
+    atomic<bool> polling(true), dashboardUp(false);
+    long long polls = 0, versionsSeen = 0, inconsistent = 0;
+    thread dashboard([&] {
+        unsigned long long seenVersion = 0;
+        KitchenSnapshot view;
+        dashboardUp = true;
+        while (polling) {
+            unsigned long long previous = seenVersion;
+            if (pollKitchenSnapshot(seenVersion, view)) {
+                versionsSeen++;
+                if (seenVersion < previous || view.queuedOrders < 0 || view.inFlightOrders < 0
+                    || view.completedOrders > (size_t)orderCount)
+                    inconsistent++;
+            }
+            polls++;
+        }
+    });
+    while (!dashboardUp)
+        this_thread::yield();
+    // A manager reprices the menu the whole time; every version prices item i at 100 * version + i,
+    // so an order bound to a half-built version would show up as a price that does not match
+    atomic<bool> repricing(true);
+    thread manager([&repricing] {
+        while (repricing) {
+            updateMenu([](MenuVersion& version) {
+                for (int i = 0; i < ITEM_COUNT; ++i)
+                    version.priceCents[i] = 100 * version.version + i;
+            });
+            this_thread::yield();
+        }
+    });
+    // Every seventh order is cancelled by its guest right after it is placed, racing the workers
+    atomic<int> nextOrderID(1);
+    vector<thread> intake;
+    vector<vector<OrderId>> cancelledIds(4);
+    for (int g = 0; g < 4; ++g) {
+        intake.emplace_back([&nextOrderID, &cancelledIds, orderCount, g] {
+            for (int id = nextOrderID++; id <= orderCount; id = nextOrderID++) {
+                Order order;
+                order.orderID = nextOrderId();
+                order.foods = { ITEM_SALAD, ITEM_PASTA };
+                order.table = 0;
+                order.isCompleted = false;
+                order.workerID = 0;
+                if (id % 2 == 0) {
+                    lock_guard<InstrumentedMutex> lock(queueMutex);
+                    int wanted = 1 + (id + g) % (int)tables.size();
+                    if (claimTableLocked(wanted))
+                        order.table = wanted;
+                }
+                auto handle = trackOrder(order, false);
+                submitOrder(order);
+                if (id % 7 == 0 && cancelOrder(*handle))
+                    cancelledIds[g].push_back(order.orderID);
+            }
+        });
+    }
+    for (auto& t : intake)
+        t.join();
+    reportDrain(drainKitchen(workers));
+    polling = false;
+    dashboard.join();
+    repricing = false;
+    manager.join();
+    cout << "Dashboard: " << polls << " polls, " << versionsSeen << " versions seen, "
+        << inconsistent << " inconsistent\n";
+    int completed = (int)completedOrders.size();
+    set<OrderId> ids;
+    set<int> menuVersions;
+    int mispriced = 0;
+    for (const auto& order : completedOrders) {
+        ids.insert(order.orderID);
+        const MenuVersion* version = order.menuVersion.get();
+        if (!version) {
+            mispriced++;
+            continue;
+        }
+        menuVersions.insert(version->version);
+        for (int i = 0; i < ITEM_COUNT; ++i)
+            if (version->version > 1 && version->priceCents[i] != 100 * version->version + i)
+                mispriced++;
+    }
+    cout << "Menu: " << currentMenu()->version << " versions published, orders bound to " << menuVersions.size()
+        << " of them, " << mispriced << " mispriced\n";
+    int cancelled = 0, cancelledButCompleted = 0;
+    for (const auto& list : cancelledIds)
+        for (OrderId id : list) {
+            cancelled++;
+            cancelledButCompleted += (int)ids.count(id);
+        }
+    int tablesHeld = (int)count(tables.begin(), tables.end(), false);
+    int malformed = 0;
+    if (logSink == LOG_RING) {
+        // Every message is one whole line (some start with a blank line); a torn write would
+        // leave a fragment, or two messages run together
+        vector<string> messages = logRingMessages();
+        for (const string& message : messages) {
+            size_t start = message.find_first_not_of('\n');
+            if (start == string::npos || message.back() != '\n' || message.find('\n', start) != message.size() - 1)
+                malformed++;
         }
+        cout << "Worker output: " << logRingNext << " messages, last " << messages.size() << " checked, "
+            << malformed << " malformed\n";
     }
+    cout << "Stress: " << completed << "/" << orderCount << " orders completed, " << cancelled << " cancelled ("
+        << cancelledButCompleted << " of them completed anyway), " << completed - (int)ids.size()
+        << " duplicate IDs, " << tablesHeld << " tables left held\n";
+    return completed + cancelled == orderCount && cancelledButCompleted == 0 && (int)ids.size() == completed
+        && tablesHeld == 0 && malformed == 0 && mispriced == 0 ? 0 : 1;
+}
 
-    while (true) {
-        // Lock the queue and wait for new orders or shutdown signal
-        unique_lock<mutex> lock(queueMutex);
-        cv.wait(lock, [] { return !orderQueue.empty() || shutdownFlag; });
-        if (shutdownFlag && orderQueue.empty())
-            break; // Exit if shutdown is signaled and no orders are left
+// Round-robin comparison in virtual time. A trace of orders (arrival time and item count) is
+// replayed on a model of the worker pool where every item takes one task duration: once run to
+// completion in arrival order (FCFS), and once in round-robin slices. A handed-back order pays
+// one context switch when it resumes; the cost is measured on the real queue.
 
-        // Retrieve the next order from the queue
-        Order currentOrder = orderQueue.front();
-        orderQueue.pop();
-        lock.unlock();
+// Structure to represent one order of a replayed trace
+struct TraceOrder {
+    double arrivalMs;          // When the order arrives
+    int items;                 // Items in the order
+};
 
-        string taskDescription;
+// Structure to represent the outcome of replaying a trace
+struct SliceRunStats {
+    double avgResponseMs = 0;        // Average time from arrival to the first item starting
+    double avgTurnaroundMs = 0;      // Average time from arrival to completion
+    double avgSmallTurnaroundMs = 0; // Same, for orders of at most 3 items
+    double avgLargeTurnaroundMs = 0; // Same, for larger orders
+    long long switches = 0;          // Times a handed-back order was resumed
+    double switchOverheadMs = 0;     // Time spent on those switches
+    double makespanMs = 0;           // Time until the last order completed
+};
 
-        // Assign a table to the order if not already assigned
-        if (currentOrder.table == 0 && currentWorker.defaultTask != 5) {
-            lock_guard<mutex> tblLock(queueMutex);
-            for (size_t i = 0; i < tables.size(); ++i) {
-                if (tables[i]) {
-                    currentOrder.table = i + 1;
-                    tables[i] = false; // Mark the table as unavailable
-                    break;
-                }
+// Function to replay a trace on 'workers' workers. 'quantum' is the slice length in items
+// (0 = FCFS, run every order to completion). As in workerFunction, an order whose quantum ran
+// out keeps its worker when nothing else is waiting.
+SliceRunStats replaySliced(const vector<TraceOrder>& trace, int workers, int quantum, double itemMs, double switchMs) {
+    SliceRunStats stats;
+    size_t n = trace.size(), next = 0, finished = 0;
+    vector<int> left(n);
+    vector<double> firstStart(n, -1), doneAt(n, 0);
+    for (size_t j = 0; j < n; ++j)
+        left[j] = trace[j].items;
+    deque<size_t> ready;
+    vector<long long> running(workers, -1);
+    vector<double> busyUntil(workers, 0);
+    double now = 0;
+    while (finished < n) {
+        while (next < n && trace[next].arrivalMs <= now)
+            ready.push_back(next++);
+        for (int w = 0; w < workers; ++w) {
+            if (running[w] < 0 || busyUntil[w] > now)
+                continue;
+            size_t j = (size_t)running[w];
+            if (left[j] == 0) {
+                doneAt[j] = busyUntil[w];
+                finished++;
+                running[w] = -1;
+            }
+            else if (ready.empty()) {
+                int slice = min(quantum, left[j]); // Nothing waiting: run the next quantum in place
+                left[j] -= slice;
+                busyUntil[w] += slice * itemMs;
             }
-            if (currentOrder.table == 0) {
-                // If no table is available, requeue the order and continue
-                lock_guard<mutex> lock(queueMutex);
-                orderQueue.push(currentOrder);
-                cv.notify_one();
+            else {
+                ready.push_back(j);
+                running[w] = -1;
+            }
+        }
+        for (int w = 0; w < workers && !ready.empty(); ++w) {
+            if (running[w] >= 0)
                 continue;
+            size_t j = ready.front();
+            ready.pop_front();
+            double cost = 0;
+            if (firstStart[j] < 0)
+                firstStart[j] = now;
+            else {
+                cost = switchMs;
+                stats.switches++;
+                stats.switchOverheadMs += cost;
             }
+            int slice = quantum > 0 ? min(quantum, left[j]) : left[j];
+            left[j] -= slice;
+            running[w] = (long long)j;
+            busyUntil[w] = now + cost + slice * itemMs;
         }
+        double upcoming = next < n ? trace[next].arrivalMs : -1;
+        for (int w = 0; w < workers; ++w)
+            if (running[w] >= 0 && (upcoming < 0 || busyUntil[w] < upcoming))
+                upcoming = busyUntil[w];
+        if (upcoming < 0)
+            break;
+        now = max(now, upcoming);
+    }
 
-        // Output the worker's task to the console
-        {
-            lock_guard<mutex> coutLock(coutMutex);
-            cout << "\nWorker " << currentWorker.workerId << " (" << currentWorker.fullName
-                << ") is processing Order " << currentOrder.orderID;
-            if (currentOrder.table != 0)
-                cout << " (Assigned Table " << currentOrder.table << ")";
-            cout << endl;
+    long long small = 0, large = 0;
+    for (size_t j = 0; j < n; ++j) {
+        double turnaround = doneAt[j] - trace[j].arrivalMs;
+        stats.avgResponseMs += firstStart[j] - trace[j].arrivalMs;
+        stats.avgTurnaroundMs += turnaround;
+        (trace[j].items <= 3 ? stats.avgSmallTurnaroundMs : stats.avgLargeTurnaroundMs) += turnaround;
+        (trace[j].items <= 3 ? small : large)++;
+        stats.makespanMs = max(stats.makespanMs, doneAt[j]);
+    }
+    stats.avgResponseMs /= max<size_t>(1, n);
+    stats.avgTurnaroundMs /= max<size_t>(1, n);
+    stats.avgSmallTurnaroundMs /= max<long long>(1, small);
+    stats.avgLargeTurnaroundMs /= max<long long>(1, large);
+    return stats;
+}
+
+// Function to measure one context switch on the real queue: checkpointing an order back into
+// the queue and dispatching it again. Returns the average cost in milliseconds.
+double measureSliceSwitchMs() {
+    const int rounds = 20000;
+    resetKitchenState(5);
+    Order order;
+    order.orderID = 1;
+    order.foods.assign(20, ITEM_SALAD);
+    order.table = 1;
+    order.isCompleted = false;
+    order.workerID = 0;
+    order.itemsDone = 10;
+    auto start = chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        lock_guard<InstrumentedMutex> lock(queueMutex);
+        inFlightOrders++;
+        checkpointOrderLocked(order);
+        popOrderLocked(order);
+        inFlightOrders--;
+    }
+    double elapsedMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    resetKitchenState(5);
+    return elapsedMs / rounds;
+}
+
+// Function to compare round robin against FCFS on one generated trace of 'orderCount' orders:
+// mostly small orders, with parties of 6-10 items and some of 20, arriving at about 90% load
+int runRoundRobinComparison(int orderCount, int quantum) {
+    const int workers = TASK_SELECT_TABLE - TASK_COOK; // Same pool as registerAutomaticWorkers
+    double itemMs = max(1, taskMillis);
+    mt19937 rng(42);
+    vector<TraceOrder> trace;
+    double meanItems = 0.05 * 20 + 0.12 * 8 + 0.83 * 2;
+    exponential_distribution<double> gap(0.9 * workers / (meanItems * itemMs));
+    double clock = 0;
+    for (int i = 0; i < orderCount; ++i) {
+        int roll = (int)(rng() % 100);
+        int items = roll < 5 ? 20 : roll < 17 ? 6 + (int)(rng() % 5) : 1 + (int)(rng() % 3);
+        trace.push_back({ clock, items });
+        clock += gap(rng);
+    }
+
+    double switchMs = measureSliceSwitchMs();
+    cout << "Round robin vs FCFS: " << orderCount << " orders, " << workers << " workers, "
+        << itemMs << " ms per item, context switch " << fixed << setprecision(4) << switchMs << " ms (measured)\n";
+    cout << setprecision(1);
+    vector<int> quanta = { 0, quantum };
+    if (quantum != 1)
+        quanta.push_back(1);
+    for (int q : quanta) {
+        SliceRunStats stats = replaySliced(trace, workers, q, itemMs, switchMs);
+        cout << "  " << (q == 0 ? string("FCFS          ") : "RR quantum " + to_string(q) + string(q < 10 ? "  " : " "))
+            << " response " << setw(9) << stats.avgResponseMs << " ms, turnaround " << setw(9) << stats.avgTurnaroundMs
+            << " ms (small " << setw(9) << stats.avgSmallTurnaroundMs << ", large " << setw(9) << stats.avgLargeTurnaroundMs
+            << "), " << stats.switches << " switches costing " << setprecision(3) << stats.switchOverheadMs
+            << setprecision(1) << " ms, makespan " << stats.makespanMs << " ms\n";
+    }
+    cout.unsetf(ios::fixed);
+    cout << setprecision(6);
+    return 0;
+}
+
+// Load shedding under overload, in real time: one stream of orders arrives at a fixed rate and is
+// run through the real kitchen twice, once taking every order and once through the admission
+// controller. Past capacity the first run's queue grows for as long as orders keep coming, and
+// so does every order's wait; shedding keeps the wait of the orders it takes near the target.
+
+// Structure to represent the outcome of one arrival stream
+struct ShedRunStats {
+    long long decisions[INTAKE_DECISION_COUNT] = {}; // Admission decisions, by outcome
+    int completed = 0;         // Orders completed
+    double p50Ms = 0;          // Median time from arrival to completion
+    double p99Ms = 0;          // 99th percentile time from arrival to completion
+    long long drainMs = 0;     // Time to finish the backlog once arrivals stopped
+};
+
+// Function to feed 'orderCount' orders, one every 'gapMs', to a running kitchen and drain it
+ShedRunStats runArrivalStream(int orderCount, double gapMs, bool shedding) {
+    ShedRunStats stats;
+    loadShedding = shedding;
+    long long before[INTAKE_DECISION_COUNT];
+    copy(begin(intakeDecisions), end(intakeDecisions), before);
+    size_t firstCompleted = completedOrders.size();
+    mt19937 rng(7);
+    vector<thread> workers;
+    startKitchen(workers);
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < orderCount; ++i) {
+        this_thread::sleep_until(start + chrono::microseconds((long long)(i * gapMs * 1000)));
+        Order order;
+        order.orderID = nextOrderId();
+        order.foods.assign(1 + rng() % 3, MenuItem(rng() % ITEM_COUNT));
+        order.table = 0;
+        order.isCompleted = false;
+        order.workerID = 0;
+        chrono::milliseconds quote(0);
+        if (shedding && decideIntake(order, quote) == INTAKE_REJECT)
+            continue;
+        trackOrder(order, false);
+        submitOrder(order);
+    }
+    stats.drainMs = drainKitchen(workers).count();
+    for (int d = 0; d < INTAKE_DECISION_COUNT; ++d)
+        stats.decisions[d] = intakeDecisions[d] - before[d];
+    vector<double> latencies;
+    for (size_t i = firstCompleted; i < completedOrders.size(); ++i)
+        latencies.push_back(chrono::duration<double, milli>(completedOrders[i].completedTime - completedOrders[i].arrivalTime).count());
+    sort(latencies.begin(), latencies.end());
+    stats.completed = (int)latencies.size();
+    if (!latencies.empty()) {
+        stats.p50Ms = latencies[latencies.size() / 2];
+        stats.p99Ms = latencies[min(latencies.size() - 1, latencies.size() * 99 / 100)];
+    }
+    return stats;
+}
+
+// Function to compare taking every order with shedding load, for one arrival rate
+int runSheddingComparison(int orderCount, double gapMs) {
+    consoleLogging = false;
+    registerAutomaticWorkers("Bench ");
+    cout << "Load shedding vs none: " << orderCount << " orders, one every " << gapMs << " ms, "
+        << workerCredentials.size() << " workers, " << taskMillis << " ms task duration, target sojourn "
+        << shedTarget().count() << " ms\n";
+    for (bool shedding : { false, true }) {
+        ShedRunStats stats = runArrivalStream(orderCount, gapMs, shedding);
+        cout << (shedding ? "  shedding     " : "  no shedding  ") << stats.completed << " completed";
+        if (shedding)
+            cout << " (" << stats.decisions[INTAKE_QUOTE_LONGER] << " quoted longer), "
+                << stats.decisions[INTAKE_REJECT] << " turned away";
+        cout << fixed << setprecision(1) << ", arrival to completion p50 " << stats.p50Ms << " ms, p99 "
+            << stats.p99Ms << " ms, backlog drained in " << stats.drainMs << " ms\n";
+        cout.unsetf(ios::fixed);
+    }
+    cout << setprecision(6);
+    return 0;
+}
+
+// Sharded deployment: each restaurant runs as its own process (a shard) with its own queue,
+// tables, stations and inventory, so no state is shared between locations. A local coordinator
+// routes orders to shards over pipes by location. When a location has a full waiting list's worth
+// of orders outstanding, it overflows the order to the nearest shard with room. Metrics are
+// aggregated from the shards' final reports.
+
+// Structure to represent the final report of one shard
+struct ShardReport {
+    long long completed = 0;   // Orders completed
+    long long onTime = 0;      // Orders completed by their deadline
+    long long misses = 0;      // Orders completed late
+    long long outOfStock = 0;  // Orders refused for missing ingredients
+    long long drainMs = 0;     // Time the shard's drain took
+};
+
+// Function executed in a shard process: reads orders from 'in', runs the kitchen, and writes
+// status lines ("status <completed> <refused>") and a final report line to 'out'
+int runShard(int shardID, FILE* in, FILE* out) {
+    consoleLogging = false;
+    seedOrderIds(shardID); // IDs issued inside the shard carry its node number
+    if (pinShardsToNodes) {
+        // Confine the shard to one node before it starts any thread; its threads inherit the
+        // mask, so pages they first write are placed on that node by first-touch. Reserving only
+        // allocates: it keeps the storage from moving later, the first writes place it. Under
+        // FCFS the lanes are deques, which grow a block at a time and cannot be reserved.
+        vector<vector<int>> nodes = numaNodes();
+        pinCurrentThread(nodes[(shardID - 1) % nodes.size()]);
+        if (dispatchPolicy == DISPATCH_EDF)
+            for (auto& lane : orderQueue.lanes)
+                lane.edf.reserve(4096);
+        completedOrders.reserve(4096);
+    }
+    registerAutomaticWorkers("Shard " + to_string(shardID) + " ");
+    vector<thread> workers;
+    startKitchen(workers);
+
+    // Report progress so the coordinator can track each shard's outstanding orders
+    atomic<bool> reporting(true);
+    atomic<long long> refused(0);
+    thread reporter([&reporting, &refused, out] {
+        while (reporting) {
+            size_t completed;
+            {
+                lock_guard<InstrumentedMutex> lock(queueMutex);
+                completed = completedOrders.size();
+            }
+            fprintf(out, "status %zu %lld\n", completed, refused.load());
+            fflush(out);
+            this_thread::sleep_for(chrono::milliseconds(5));
         }
+    });
 
-        // Perform the worker's task for each food item in the order
-        for (const auto& food : currentOrder.foods) {
-            switch (currentWorker.defaultTask) {
-            case 1:
-                taskDescription = taskNames[0] + " " + food;
-                cout << "Cooking " << food << "...\n";
-                break;
-            case 2:
-                taskDescription = taskNames[1] + " " + food;
-                cout << "Serving " << food << "...\n";
-                break;
-            case 3:
-                taskDescription = taskNames[2] + " (at Table " + to_string(currentOrder.table) + ")";
-                cout << "Cleaning Table " << currentOrder.table << "...\n";
-                break;
-            case 4:
-                taskDescription = taskNames[3] + " (at Table " + to_string(currentOrder.table) + ")";
-                cout << "Washing Dishes for Table " << currentOrder.table << "...\n";
-                break;
-            case 5: {
-                // Allow the worker to manually select a table
-                bool validTableSelected = false;
-                while (!validTableSelected) {
-                    cout << "\nWorker " << currentWorker.workerId
-                        << " (" << currentWorker.fullName << ") - Choose a table for Order "
-                        << currentOrder.orderID << ":\n";
-                    displayAvailableTables();
-                    cout << "Enter table number: ";
-                    int chosenTable;
-                    cin >> chosenTable;
-                    if (chosenTable < 1 || chosenTable >(int)tables.size()) {
-                        cout << "Invalid table number. Try again.\n";
+    // Intake: "<orderID> <item> <item> ..." per line, until the coordinator closes the pipe
+    char line[512];
+    while (fgets(line, sizeof(line), in) != nullptr) {
+        stringstream ss(line);
+        Order order;
+        ss >> order.orderID;
+        int item;
+        while (ss >> item)
+            if (item >= 0 && item < ITEM_COUNT)
+                order.foods.push_back(MenuItem(item));
+        order.table = 0;
+        order.isCompleted = false;
+        order.workerID = 0;
+        order.holdsIngredients = reserveIngredients(order.foods);
+        if (!order.holdsIngredients)
+            refused++;
+        else if (!submitOrder(order)) {
+            releaseIngredients(order.foods);
+            refused++;
+        }
+    }
+
+    chrono::milliseconds drainTime = drainKitchen(workers);
+    reporting = false;
+    reporter.join();
+    fprintf(out, "final %zu %lld %lld %lld %lld\n", completedOrders.size(), ordersOnTime.load(),
+        deadlineMisses.load(), ordersOutOfStock.load(), (long long)drainTime.count());
+    fflush(out);
+    return 0;
+}
+
+#ifndef _WIN32
+// Structure to represent the coordinator's link to one shard process
+struct ShardLink {
+    pid_t pid = 0;                          // Shard process
+    FILE* toShard = nullptr;                // Order pipe
+    FILE* fromShard = nullptr;              // Status pipe
+    thread reader;                          // Thread reading status lines
+    atomic<long long> resolved{ 0 };        // Orders the shard reported completed or refused
+    long long routed = 0;                   // Orders sent to the shard
+    long long overflowIn = 0;               // Orders received from other locations
+    ShardReport report;                     // Final report (valid after the reader exits)
+};
+
+// Function to run the coordinator over 'shardCount' shard processes with a generated order stream.
+// Every shard is forked before the coordinator starts any thread, so no child inherits a copy
+// of the process taken while another thread held a lock.
+int runShardedDeployment(int shardCount, int orderCount) {
+    if (shardCount < 1 || shardCount > ORDER_ID_MAX_NODE) {
+        cout << "Shard count must be between 1 and " << ORDER_ID_MAX_NODE << " (node bits of an order ID).\n";
+        return 1;
+    }
+    vector<unique_ptr<ShardLink>> shards;
+    for (int id = 0; id < shardCount; ++id) {
+        int down[2], up[2];
+        if (pipe(down) != 0 || pipe(up) != 0) {
+            cout << "Could not create shard pipes.\n";
+            return 1;
+        }
+        cout.flush();
+        pid_t pid = fork();
+        if (pid == 0) {
+            // Shard process: keep only its own pipe ends
+            for (const auto& other : shards) {
+                fclose(other->toShard);
+                fclose(other->fromShard);
+            }
+            close(down[1]);
+            close(up[0]);
+            FILE* in = fdopen(down[0], "r");
+            FILE* out = fdopen(up[1], "w");
+            int status = runShard(id + 1, in, out);
+            fclose(out);
+            _exit(status);
+        }
+        close(down[0]);
+        close(up[1]);
+        auto link = make_unique<ShardLink>();
+        link->pid = pid;
+        link->toShard = fdopen(down[1], "w");
+        link->fromShard = fdopen(up[0], "r");
+        shards.push_back(move(link));
+    }
+    for (auto& link : shards) {
+        ShardLink* raw = link.get();
+        link->reader = thread([raw] {
+            char line[256];
+            while (fgets(line, sizeof(line), raw->fromShard) != nullptr) {
+                long long completed, refused;
+                ShardReport& r = raw->report;
+                if (sscanf(line, "status %lld %lld", &completed, &refused) == 2)
+                    raw->resolved = completed + refused;
+                else if (sscanf(line, "final %lld %lld %lld %lld %lld", &r.completed, &r.onTime,
+                    &r.misses, &r.outOfStock, &r.drainMs) == 5)
+                    raw->resolved = r.completed + r.outOfStock;
+            }
+        });
+    }
+
+    // Route orders: half go to location 1 (the busy one), the rest spread evenly
+    mt19937 rng(7);
+    long long overflowed = 0;
+    long long outstandingCap = max(1, waitingListCapacity); // Orders a shard may have outstanding (a config may set 0)
+    auto routeStart = chrono::steady_clock::now();
+    for (int i = 0; i < orderCount; ++i) {
+        int location = rng() % 2 == 0 ? 0 : (int)(rng() % shardCount);
+        int itemCount = 1 + (int)(rng() % 3);
+        string line = to_string(nextOrderId());
+        for (int j = 0; j < itemCount; ++j)
+            line += " " + to_string(rng() % ITEM_COUNT);
+
+        // Pick the home shard, or the nearest one with room; wait if every shard is full
+        int target = -1;
+        while (target < 0) {
+            for (int distance = 0; distance < shardCount && target < 0; ++distance) {
+                for (int candidate : { location - distance, location + distance }) {
+                    if (candidate < 0 || candidate >= shardCount)
                         continue;
-                    }
-                    lock_guard<mutex> lock(queueMutex);
-                    if (tables[chosenTable - 1]) {
-                        tables[chosenTable - 1] = false;
-                        currentOrder.table = chosenTable;
-                        validTableSelected = true;
-                    }
-                    else {
-                        cout << "Table " << chosenTable << " is unavailable. Choose another.\n";
+                    ShardLink& shard = *shards[candidate];
+                    if (shard.routed - shard.resolved < outstandingCap) {
+                        target = candidate;
+                        break;
                     }
                 }
-                taskDescription = taskNames[4] + " (set to Table " + to_string(currentOrder.table) + ")";
-                break;
-            }
-            default:
-                taskDescription = "No valid task selected";
-                cout << "Invalid task for worker " << currentWorker.workerId << "\n";
-                break;
             }
-            this_thread::sleep_for(chrono::seconds(1)); // Simulate task duration
+            if (target < 0)
+                this_thread::sleep_for(chrono::milliseconds(1));
+        }
+        ShardLink& shard = *shards[target];
+        if (target != location) {
+            overflowed++;
+            shard.overflowIn++;
         }
+        shard.routed++;
+        fprintf(shard.toShard, "%s\n", line.c_str());
+        fflush(shard.toShard);
+    }
 
-        // Mark the order as completed and release the table
-        currentOrder.foods.clear();
-        currentOrder.isCompleted = true;
-        currentOrder.workerID = currentWorker.workerId;
+    // Close intake: each shard drains and sends its final report
+    for (auto& shard : shards) {
+        fclose(shard->toShard);
+        shard->reader.join();
+        fclose(shard->fromShard);
+        waitpid(shard->pid, nullptr, 0);
+    }
+    long long totalMs = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - routeStart).count();
 
-        {
-            lock_guard<mutex> lock(queueMutex);
-            completedOrders.push_back(currentOrder);
-        }
+    cout << "\n=== Sharded Deployment (" << shardCount << " locations) ===\n";
+    ShardReport total;
+    for (int id = 0; id < shardCount; ++id) {
+        const ShardLink& shard = *shards[id];
+        const ShardReport& r = shard.report;
+        cout << "Location " << id + 1 << ": " << shard.routed << " routed (" << shard.overflowIn
+            << " overflow), " << r.completed << " completed, " << r.onTime << " on time, "
+            << r.outOfStock << " out of stock, drained in " << r.drainMs << " ms\n";
+        total.completed += r.completed;
+        total.onTime += r.onTime;
+        total.misses += r.misses;
+        total.outOfStock += r.outOfStock;
+    }
+    cout << "Total: " << total.completed << "/" << orderCount << " completed, " << overflowed
+        << " overflowed to a nearby location, "
+        << (total.completed > 0 ? 100 * total.onTime / total.completed : 0) << "% on time, "
+        << total.outOfStock << " out of stock, " << totalMs << " ms\n";
+    return total.completed + total.outOfStock == orderCount ? 0 : 1;
+}
+#else
+int runShardedDeployment(int, int) {
+    cout << "Sharded mode needs POSIX processes and is not available on this platform.\n";
+    return 1;
+}
+#endif
+
+// Function to run one kitchen over a generated batch of orders, with no inventory limits;
+// returns the number of completed orders
+size_t runKitchenBatch(int orderCount, unsigned seed) {
+    registerAutomaticWorkers("Bench ");
+    mt19937 rng(seed);
+    vector<thread> workers;
+    startKitchen(workers);
+    for (int i = 0; i < orderCount; ++i) {
+        Order order;
+        order.orderID = nextOrderId();
+        for (int j = 1 + (int)(rng() % 3); j > 0; --j)
+            order.foods.push_back(MenuItem(rng() % ITEM_COUNT));
+        order.table = 0;
+        order.isCompleted = false;
+        order.workerID = 0;
+        submitOrder(order);
+    }
+    drainKitchen(workers);
+    return completedOrders.size();
+}
 
-        cout << "\nOrder " << currentOrder.orderID << " completed by Worker "
-            << currentWorker.workerId << "\n";
+#ifndef _WIN32
+// Function to compare unpinned, pinned and per-node sharded throughput on the same workload.
+// Each variant runs in a fresh child process so they start from identical state.
+int runAffinityBenchmark(int orderCount) {
+    vector<vector<int>> nodes = numaNodes();
+    int shardCount = max(2, (int)nodes.size());
+    const char* variants[] = { "unpinned", "pinned", "per-node sharded" };
+    cout << "\n=== Placement Benchmark (" << orderCount << " orders, " << nodes.size() << " NUMA node(s), "
+        << taskMillis << " ms tasks) ===\n";
+    for (int variant = 0; variant < 3; ++variant) {
+        auto start = chrono::steady_clock::now();
+        cout.flush();
+        pid_t pid = fork();
+        if (pid == 0) {
+            if (freopen("/dev/null", "w", stdout) == nullptr)
+                _exit(1);
+            consoleLogging = false;
+            for (int& portions : initialStock)
+                portions = 1 << 28;   // Measure placement, not stock-outs
+            resetInventory();
+            if (variant == 1)
+                addPinning("auto");
+            if (variant == 2) {
+                pinShardsToNodes = true;
+                _exit(runShardedDeployment(shardCount, orderCount));
+            }
+            _exit(runKitchenBatch(orderCount, 11) == (size_t)orderCount ? 0 : 1);
+        }
+        int status = 0;
+        waitpid(pid, &status, 0);
+        long long ms = max<long long>(1, chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count());
+        cout << variants[variant] << ": " << ms << " ms, " << 1000LL * orderCount / ms << " orders/s"
+            << (WIFEXITED(status) && WEXITSTATUS(status) == 0 ? "" : " (run failed)") << "\n";
     }
+    return 0;
 }
+#else
+int runAffinityBenchmark(int) {
+    cout << "The placement benchmark needs POSIX processes and is not available on this platform.\n";
+    return 1;
+}
+#endif
+
+int main(int argc, char* argv[]) {
+    seedOrderIds(0);
+    publishBaseMenu();
+    sizeKitchen(); // For the defaults; a config file sizes the kitchen again
+
+    // Command-line switches for staging diagnostics
+    string tracePath;
+    string exportPath;
+    string reservationsPath;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--lock-stats")
+            lockInstrumentation = true;
+        else if (arg == "--explore" && i + 2 < argc) {
+            unsigned seed = (unsigned)stoul(argv[i + 1]);
+            long long runs = stoll(argv[i + 2]);
+            return exploreSchedules(seed, runs) == 0 ? 0 : 1;
+        }
+        else if (arg == "--stress" && i + 1 < argc) {
+            return stressKitchen(stoi(argv[i + 1]));
+        }
+        else if (arg == "--config" && i + 1 < argc) {
+            if (!loadKitchenConfig(argv[++i]))
+                return 1;
+        }
+        else if (arg == "--quiet")
+            consoleLogging = false;
+        else if (arg == "--menu" && i + 1 < argc)
+            menuPath = argv[++i];
+        else if (arg == "--shed") {
+            // Load shedding, with an optional target sojourn in ms
+            loadShedding = true;
+            if (i + 1 < argc && isdigit((unsigned char)argv[i + 1][0]))
+                shedTargetMs = stoi(argv[++i]);
+        }
+        else if (arg == "--log" && i + 1 < argc) {
+            // Worker output: "off", "stdout", "ring" or a file path
+            string target = argv[++i];
+            consoleLogging = target != "off";
+            if (consoleLogging && !setLogSink(target)) {
+                cout << "Could not open " << target << "\n";
+                return 1;
+            }
+        }
+        else if (arg == "--task-ms" && i + 1 < argc)
+            taskMillis = stoi(argv[++i]);
+        else if (arg == "--pin" && i + 1 < argc)
+            addPinning(argv[++i]);
+        else if (arg == "--pin-shards")
+            pinShardsToNodes = true;
+        else if (arg == "--affinity-bench" && i + 1 < argc) {
+            resetInventory();
+            return runAffinityBenchmark(stoi(argv[i + 1]));
+        }
+        else if (arg == "--shards" && i + 2 < argc) {
+            resetInventory();
+            return runShardedDeployment(stoi(argv[i + 1]), stoi(argv[i + 2]));
+        }
+        else if (arg == "--trace" && i + 1 < argc) {
+            tracePath = argv[++i];
+            tracingEnabled = true;
+        }
+        else if (arg == "--reservations" && i + 1 < argc)
+            reservationsPath = argv[++i]; // Imported once every switch is parsed and the kitchen is sized
+        else if (arg == "--export" && i + 1 < argc)
+            exportPath = argv[++i];
+        else if (arg == "--export-bench" && i + 2 < argc)
+            return runExportBenchmark(stoll(argv[i + 1]), argv[i + 2]);
+        else if (arg == "--report" && i + 1 < argc)
+            return runColumnarReport(argv[i + 1]);
+        else if (arg == "--report-bench" && i + 1 < argc)
+            return runReportBenchmark(stoll(argv[i + 1]));
+        else if (arg == "--rr" && i + 1 < argc) {
+            // Round-robin quantum: "<n>" items, or "<n>ms" of time
+            string quantum = argv[++i];
+            if (quantum.size() > 2 && quantum.compare(quantum.size() - 2, 2, "ms") == 0)
+                sliceQuantumMillis = stoi(quantum);
+            else
+                sliceQuantumItems = stoi(quantum);
+        }
+        else if (arg == "--rr-bench" && i + 2 < argc)
+            return runRoundRobinComparison(stoi(argv[i + 1]), stoi(argv[i + 2]));
+        else if (arg == "--shed-bench" && i + 2 < argc) {
+            resetInventory();
+            return runSheddingComparison(stoi(argv[i + 1]), stod(argv[i + 2]));
+        }
+    }
+    setTraceThreadName("main");
+    if (!reservationsPath.empty()) {
+        ifstream bookings(reservationsPath);
+        if (bookings)
+            importReservations(bookings);
+        else
+            cout << "Could not open " << reservationsPath << "\n";
+    }
+    if (!menuPath.empty())
+        startMenuWatcher(menuPath);
+
+    resetInventory();
 
-int main() {
     char role;
-    cout << "Are you a guest or worker? (g/w): ";
+    cout << "Are you a guest, worker or simulation? (g/w/s): ";
     cin >> role;
 
     if (role == 'w' || role == 'W') {
-        // Worker registration process
-        cout << "\n=== Worker Registration ===\n";
+        // Worker registration process (skipped when the config file lists the roster)
+        if (workerCredentials.empty())
+            cout << "\n=== Worker Registration ===\n";
         set<int> chosenTasks;
-        int registered = 0;
+        int registered = workerCredentials.empty() ? 0 : 5;
         while (registered < 5) {
             WorkerCredential wc;
             while (true) {
@@ -278,39 +5354,175 @@ int main() {
             cout << "Task: " << taskNames[wc.defaultTask - 1] << " - Worker ID: " << wc.workerId << " (" << wc.fullName << ")\n";
         }
 
-        // Create worker threads
+        // Create worker threads, then drain: the run ends as soon as all orders are done
         vector<thread> workers;
-        for (const auto& wc : workerCredentials) {
-            workers.emplace_back(workerFunction, wc.workerId);
+        startKitchen(workers);
+        reportDrain(drainKitchen(workers));
+
+        cout << "\nAll orders processed.\n";
+    }
+    else if (role == 's' || role == 'S') {
+        // Batch simulation: a fixed roster works through generated orders, then drains
+        // (a config file supplies every setting, so nothing is asked)
+        int orderCount = configuredOrders, deadlineSeconds = runSeconds;
+        cout << "\n=== Simulation ===\n";
+        if (!kitchenConfigured) {
+            cout << "Number of orders: ";
+            cin >> orderCount;
+            cout << "Task duration (ms): ";
+            cin >> taskMillis;
+            cout << "Drain deadline in seconds (0 = no deadline): ";
+            cin >> deadlineSeconds;
+            char bankersChoice;
+            cout << "Use Banker's admission control? (y/n): ";
+            cin >> bankersChoice;
+            bankersEnabled = (bankersChoice == 'y' || bankersChoice == 'Y');
+            char policyChoice;
+            cout << "Dispatch policy (f = FCFS, e = EDF, r = round robin): ";
+            cin >> policyChoice;
+            dispatchPolicy = (policyChoice == 'e' || policyChoice == 'E') ? DISPATCH_EDF : DISPATCH_FCFS;
+            if (policyChoice == 'r' || policyChoice == 'R') {
+                cout << "Round-robin quantum (items): ";
+                cin >> sliceQuantumItems;
+            }
+            cout << "Batch size (1 = no batching): ";
+            cin >> batchSizeLimit;
+            updateBatchingEnabled();
         }
+        if (!batchWaitConfigured)
+            batchMaxWaitMillis = taskMillis;
 
-        // Wait for some time before shutting down
-        this_thread::sleep_for(chrono::seconds(20));
-        shutdownFlag = true;
-        cv.notify_all();
-        for (auto& worker : workers)
-            worker.join();
+        // Workers from the config roster that need console input (Select Table) are left out
+        workerCredentials.erase(remove_if(workerCredentials.begin(), workerCredentials.end(),
+            [](const WorkerCredential& wc) { return wc.defaultTask == TASK_SELECT_TABLE; }), workerCredentials.end());
+        if (workerCredentials.empty())
+            registerAutomaticWorkers("Sim ");
 
-        cout << "\nAll orders processed.\n";
+        mt19937 rng(42);
+        vector<thread> workers;
+        vector<shared_ptr<OrderHandle>> handles;
+        startKitchen(workers);
+        for (int i = 0; i < orderCount; ++i) {
+            Order newOrder;
+            newOrder.orderID = nextOrderId();
+            int itemCount = rng() % 8 == 0 ? 6 + (int)(rng() % 5) : 1 + (int)(rng() % 3); // Some parties
+            newOrder.menuVersion = currentMenu();
+            for (int j = 0; j < itemCount; ++j) {
+                MenuItem food = MenuItem(rng() % ITEM_COUNT);
+                if (newOrder.menuVersion->available[food]) // Guests only order what is on the menu
+                    newOrder.foods.push_back(food);
+            }
+            if (newOrder.foods.empty())
+                continue;
+            int roll = (int)(rng() % 100); // Mostly normal orders, with some rush, VIP and re-fired dishes
+            newOrder.priority = roll < 2 ? PRIORITY_REFIRE : roll < 7 ? PRIORITY_VIP : roll < 17 ? PRIORITY_RUSH : PRIORITY_NORMAL;
+            if (newOrder.priority == PRIORITY_REFIRE)
+                newOrder.foods.resize(1);
+            newOrder.table = 0;
+            newOrder.isCompleted = false;
+            newOrder.workerID = 0;
+            chrono::milliseconds quotedWait(0);
+            if (loadShedding && decideIntake(newOrder, quotedWait) == INTAKE_REJECT)
+                continue;
+            if (!reserveIngredients(newOrder.foods))
+                continue;
+            handles.push_back(trackOrder(newOrder, true));
+            if (!submitOrder(newOrder))
+                releaseIngredients(newOrder.foods);
+            // A few guests cancel an earlier order, or swap an item of one still waiting
+            int change = (int)(rng() % 100);
+            if (change < 3)
+                cancelOrder(*handles[rng() % handles.size()]);
+            else if (change < 5) {
+                OrderHandle& target = *handles[rng() % handles.size()];
+                vector<MenuItem> foods = target.foods; // Only this thread writes a handle's items
+                foods.back() = MenuItem(rng() % ITEM_COUNT);
+                modifyOrder(target, foods);
+            }
+        }
+
+        chrono::milliseconds drainTime = deadlineSeconds > 0
+            ? stopKitchen(workers, chrono::seconds(deadlineSeconds))
+            : drainKitchen(workers);
+        reportDrain(drainTime);
     }
     else if (role == 'g' || role == 'G') {
         // Guest order placement process
+        vector<shared_ptr<OrderHandle>> myOrders; // Orders placed in this session, for cancel or change
         while (true) {
             char continueChoice;
-            cout << "\nDo you want to place an order? (y/n): ";
-            cin >> continueChoice;
-            if (continueChoice == 'n' || continueChoice == 'N') {
+            cout << "\nDo you want to place an order? (y/n, r to reserve a table for later, c to cancel or change an order): ";
+            if (!(cin >> continueChoice) || continueChoice == 'n' || continueChoice == 'N') { // Also at end of input
                 cout << "Exiting guest system. Goodbye!\n";
                 break;
             }
-
-            if (waitingList.size() >= 10) {
-                cout << "Waiting list full. Try again later.\n";
-                break;
+            if (continueChoice == 'c' || continueChoice == 'C') {
+                OrderId id;
+                char action;
+                cout << "Order ID: ";
+                cin >> id;
+                auto it = find_if(myOrders.begin(), myOrders.end(),
+                    [id](const shared_ptr<OrderHandle>& h) { return h->orderID == id; });
+                if (it == myOrders.end()) {
+                    cout << "No order with that ID was placed here.\n";
+                    continue;
+                }
+                cout << "Cancel it or change the items? (c/m): ";
+                cin >> action;
+                if (action == 'c' || action == 'C') {
+                    if (cancelOrder(**it))
+                        cout << "Order cancelled.\n";
+                    else
+                        cout << ((*it)->state == ORDER_CANCELLED ? "That order was already cancelled.\n"
+                            : "Too late: the order is already finished.\n");
+                    continue;
+                }
+                auto menuNow = currentMenu();
+                displayFoodMenu(*menuNow);
+                cout << "Enter the new food numbers (space-separated): ";
+                cin.ignore();
+                string input;
+                getline(cin, input);
+                vector<MenuItem> foods;
+                stringstream ss(input);
+                int choice;
+                while (ss >> choice)
+                    if (choice >= 1 && choice <= ITEM_COUNT && menuNow->available[choice - 1])
+                        foods.push_back(MenuItem(choice - 1));
+                if (foods.empty())
+                    cout << "No items chosen; the order is unchanged.\n";
+                else if (modifyOrder(**it, foods))
+                    cout << "Order changed.\n";
+                else
+                    cout << "Could not change it: the kitchen has started on it, or an ingredient ran out.\n";
+                continue;
+            }
+            if (continueChoice == 'r' || continueChoice == 'R') {
+                int table, minutes;
+                string when, guestName;
+                chrono::system_clock::time_point startTime;
+                cout << "Table number (1-" << tables.size() << "): ";
+                cin >> table;
+                cin.ignore();
+                cout << "Date and time (YYYY-MM-DD HH:MM): ";
+                getline(cin, when);
+                cout << "How long, in minutes: ";
+                cin >> minutes;
+                cin.ignore();
+                cout << "Name for the booking: ";
+                getline(cin, guestName);
+                long long reservationId = parseLocalTime(when, startTime)
+                    ? bookReservation(table, startTime, chrono::minutes(minutes), guestName) : 0;
+                if (reservationId != 0)
+                    cout << "Booked. Your reservation number: " << reservationId << "\n";
+                else
+                    cout << "That table is not free then (or the booking was invalid).\n";
+                continue;
             }
 
-            vector<string> foodList = { "Pizza", "Burger", "Pasta", "Salad" };
-            displayFoodMenu(foodList);
+            // The order is placed under the menu the guest was shown, even if it changes meanwhile
+            auto menuNow = currentMenu();
+            displayFoodMenu(*menuNow);
             cout << "Enter food numbers (space-separated) or type 'exit' to quit: ";
             cin.ignore();
             string input;
@@ -319,18 +5531,25 @@ int main() {
                 cout << "Exiting guest system. Goodbye!\n";
                 break;
             }
-            vector<string> selectedFoods;
+            vector<MenuItem> selectedFoods;
             stringstream ss(input);
             int choice;
             while (ss >> choice) {
-                if (choice >= 1 && choice <= (int)foodList.size()) {
-                    selectedFoods.push_back(foodList[choice - 1]);
+                if (choice >= 1 && choice <= ITEM_COUNT) {
+                    if (menuNow->available[choice - 1])
+                        selectedFoods.push_back(MenuItem(choice - 1));
+                    else
+                        cout << menuNow->names[choice - 1] << " is off the menu today.\n";
                 }
             }
+            if (!reserveIngredients(selectedFoods)) {
+                cout << "Sorry, we do not have the ingredients for that order.\n";
+                continue;
+            }
 
             displayAvailableTables();
             int tableChoice;
-            cout << "Choose a table number (1-5): ";
+            cout << "Choose a table number (1-" << tables.size() << "): ";
             cin >> tableChoice;
             cin.ignore();
 
@@ -338,47 +5557,104 @@ int main() {
             cout << "Enter your name: ";
             getline(cin, guestName);
 
-            if (tableChoice >= 1 && tableChoice <= 5) {
-                if (!tables[tableChoice - 1]) {
-                    cout << "Table is unavailable. Adding you to waiting list.\n";
-                    waitingList.push_back(guestName + " (Table " + to_string(tableChoice) + ")");
-                    displayWaitingList();
+            if (tableChoice >= 1 && tableChoice <= (int)tables.size()) {
+                if (tableHeldForReservation(tableChoice)) {
+                    bool checkedIn = checkInReservation(tableChoice, 0, guestName);
+                    if (!checkedIn) {
+                        long long reservationId = 0;
+                        cout << "Table " << tableChoice << " is reserved. Enter your reservation number (0 if none): ";
+                        cin >> reservationId;
+                        cin.ignore();
+                        checkedIn = reservationId != 0 && checkInReservation(tableChoice, reservationId, "");
+                    }
+                    if (checkedIn)
+                        cout << "Welcome, your reservation is checked in.\n";
+                }
+                bool claimed;
+                {
+                    lock_guard<InstrumentedMutex> lock(queueMutex);
+                    claimed = claimTableLocked(tableChoice);
+                }
+                if (!claimed) {
+                    releaseIngredients(selectedFoods);
+                    bool listed = false;
+                    {
+                        lock_guard<InstrumentedMutex> lock(queueMutex);
+                        if ((int)waitingList.size() < waitingListCapacity) {
+                            waitingList.push_back(guestName + " (Table " + to_string(tableChoice) + ")");
+                            publishSnapshotLocked();
+                            listed = true;
+                        }
+                    }
+                    if (listed) {
+                        cout << "Table is unavailable. Adding you to waiting list.\n";
+                        displayWaitingList();
+                    }
+                    else
+                        cout << "Table is unavailable and the waiting list is full. Please try again later.\n";
                     continue;
                 }
-                tables[tableChoice - 1] = false;
             }
             else {
+                releaseIngredients(selectedFoods);
                 cout << "Invalid table number.\n";
                 continue;
             }
 
             // Create a new order and add it to the queue
             Order newOrder;
-            newOrder.orderID = orderCounter++;
+            newOrder.orderID = nextOrderId();
             newOrder.foods = selectedFoods;
+            newOrder.menuVersion = menuNow;
             newOrder.table = tableChoice;
+            char priorityChoice;
+            cout << "Priority (n = normal, r = rush, v = VIP): ";
+            cin >> priorityChoice;
+            newOrder.priority = priorityChoice == 'v' || priorityChoice == 'V' ? PRIORITY_VIP
+                : priorityChoice == 'r' || priorityChoice == 'R' ? PRIORITY_RUSH : PRIORITY_NORMAL;
             newOrder.isCompleted = false;
             newOrder.workerID = 0;
 
-            {
-                lock_guard<mutex> lock(queueMutex);
-                orderQueue.push(newOrder);
+            // The admission controller may turn the order away, or warn of a longer wait
+            chrono::milliseconds quotedWait(0);
+            IntakeDecision intake = loadShedding ? decideIntake(newOrder, quotedWait) : INTAKE_ACCEPT;
+            if (intake == INTAKE_REJECT) {
+                releaseIngredients(selectedFoods);
+                {
+                    lock_guard<InstrumentedMutex> lock(queueMutex);
+                    releaseTableLocked(tableChoice);
+                }
+                cout << "Sorry, the kitchen is at capacity and cannot take new orders right now. Please try again shortly.\n";
+                continue;
             }
-            cv.notify_one();
-
-            cout << "Order placed. Your order ID: " << newOrder.orderID << endl;
-            displayWaitingList();
 
-            // Check if all tables are unavailable and the waiting list is full
-            bool allTablesUnavailable = all_of(tables.begin(), tables.end(), [](bool t) { return !t; });
-            if (allTablesUnavailable && waitingList.size() >= 10) {
-                cout << "All tables are now unavailable and waiting list is full. Exiting guest system.\n";
+            myOrders.push_back(trackOrder(newOrder, true));
+            chrono::milliseconds estimatedWait(0);
+            if (!submitOrder(newOrder, &estimatedWait)) {
+                releaseIngredients(selectedFoods);
+                cout << "The kitchen is closed for new orders.\n";
                 break;
             }
+
+            if (intake == INTAKE_QUOTE_LONGER) {
+                estimatedWait = max(estimatedWait, quotedWait);
+                cout << "The kitchen is busy, so your order will take longer than usual.\n";
+            }
+            cout << "Order placed. Your order ID: " << newOrder.orderID
+                << ". Estimated ready in " << (estimatedWait.count() + 999) / 1000 << " s." << endl;
+            displayLowStock();
+            displayWaitingList();
         }
     }
     else {
         cout << "Invalid input. Exiting...\n";
     }
+    stopMenuWatcher();
+    if (!tracePath.empty())
+        writeChromeTrace(tracePath);
+    if (!exportPath.empty()) {
+        lock_guard<InstrumentedMutex> lock(queueMutex);
+        exportOrderHistory(exportPath, completedOrders);
+    }
     return 0;
 }
\ No newline at end of file